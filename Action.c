@@ -139,6 +139,7 @@ bool Action_setUserOnly(const char* userName, uid_t* userId) {
 
 static void tagAllChildren(Panel* panel, Process* parent) {
    parent->tag = true;
+   parent->displayDirty |= PROCESS_DIRTY_TAG;
    pid_t ppid = parent->pid;
    for (int i = 0; i < Panel_size(panel); i++) {
       Process* p = (Process*) Panel_get(panel, i);
@@ -250,17 +251,22 @@ static Htop_Reaction actionIncFilter(State* st) {
 }
 
 static Htop_Reaction actionIncSearch(State* st) {
+   // Searches walk the rows past the ones in sight
+   ProcessList_completeSort(st->pl);
+   st->pl->sortAll = true;
    IncSet_reset(((MainPanel*)st->panel)->inc, INC_SEARCH);
    IncSet_activate(((MainPanel*)st->panel)->inc, INC_SEARCH, st->panel);
    return HTOP_REFRESH | HTOP_KEEP_FOLLOWING;
 }
 
 static Htop_Reaction actionIncNext(State* st) {
+   ProcessList_completeSort(st->pl);
    return IncSet_next(((MainPanel*)st->panel)->inc, INC_SEARCH, st->panel, (IncMode_GetPanelValue)MainPanel_getValue, st->repeat) ?
       (HTOP_REFRESH | HTOP_KEEP_FOLLOWING | Action_follow(st)) : HTOP_OK;
 }
 
 static Htop_Reaction actionIncPrev(State* st) {
+   ProcessList_completeSort(st->pl);
    return IncSet_prev(((MainPanel*)st->panel)->inc, INC_SEARCH, st->panel, (IncMode_GetPanelValue)MainPanel_getValue, st->repeat) ?
       (HTOP_REFRESH | HTOP_KEEP_FOLLOWING | Action_follow(st)) : HTOP_OK;
 }
@@ -600,6 +606,7 @@ static Htop_Reaction actionUntagAll(State* st) {
    for (int i = 0; i < Panel_size(st->panel); i++) {
       Process* p = (Process*) Panel_get(st->panel, i);
       p->tag = false;
+      p->displayDirty |= PROCESS_DIRTY_TAG;
    }
    return HTOP_REFRESH;
 }
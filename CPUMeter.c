@@ -187,6 +187,20 @@ static void AllCPUsMeter_updateMode(Meter* this, int mode) {
    this->h = h * (strchr(Meter_name(this), '2') ? (count+1) / 2 : count);
 }
 
+static void AllCPUsMeter_sample(Meter* this) {
+   Meter **meters = this->drawData;
+   int start, count;
+   AllCPUsMeter_getRange(this, &start, &count);
+   for (int i = 0; i < count; i++) {
+      Meter_sample(meters[i]);
+      // The CPUs are only drawn as part of this meter
+      if (meters[i]->changed) {
+         meters[i]->changed = false;
+         this->changed = true;
+      }
+   }
+}
+
 static void DualColCPUsMeter_draw(Meter* this, int x, int y, int w) {
    Meter **meters = this->drawData;
    int start, count;
@@ -248,6 +262,7 @@ MeterClass AllCPUsMeter_class = {
    .draw = SingleColCPUsMeter_draw,
    .init = AllCPUsMeter_init,
    .updateMode = AllCPUsMeter_updateMode,
+   .sample = AllCPUsMeter_sample,
    .done = AllCPUsMeter_done
 };
 
@@ -267,6 +282,7 @@ MeterClass AllCPUs2Meter_class = {
    .draw = DualColCPUsMeter_draw,
    .init = AllCPUsMeter_init,
    .updateMode = AllCPUsMeter_updateMode,
+   .sample = AllCPUsMeter_sample,
    .done = AllCPUsMeter_done
 };
 
@@ -286,6 +302,7 @@ MeterClass LeftCPUsMeter_class = {
    .draw = SingleColCPUsMeter_draw,
    .init = AllCPUsMeter_init,
    .updateMode = AllCPUsMeter_updateMode,
+   .sample = AllCPUsMeter_sample,
    .done = AllCPUsMeter_done
 };
 
@@ -305,6 +322,7 @@ MeterClass RightCPUsMeter_class = {
    .draw = SingleColCPUsMeter_draw,
    .init = AllCPUsMeter_init,
    .updateMode = AllCPUsMeter_updateMode,
+   .sample = AllCPUsMeter_sample,
    .done = AllCPUsMeter_done
 };
 
@@ -324,6 +342,7 @@ MeterClass LeftCPUs2Meter_class = {
    .draw = DualColCPUsMeter_draw,
    .init = AllCPUsMeter_init,
    .updateMode = AllCPUsMeter_updateMode,
+   .sample = AllCPUsMeter_sample,
    .done = AllCPUsMeter_done
 };
 
@@ -343,6 +362,7 @@ MeterClass RightCPUs2Meter_class = {
    .draw = DualColCPUsMeter_draw,
    .init = AllCPUsMeter_init,
    .updateMode = AllCPUsMeter_updateMode,
+   .sample = AllCPUsMeter_sample,
    .done = AllCPUsMeter_done
 };
 
@@ -103,6 +103,8 @@ typedef enum {
 
 #define KEY_ALT(x) (KEY_F(64 - 26) + ((x) - 'A'))
 
+typedef void(*CRT_FdHandler)(void*);
+
 }*/
 
 #include "config.h"
@@ -115,6 +117,7 @@ typedef enum {
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <unistd.h>
+#include <poll.h>
 #include <stdio.h>
 #include <errno.h>
 #include <signal.h>
@@ -1120,6 +1123,8 @@ void CRT_init(const Settings *settings) {
    nonl();
    intrflush(stdscr, false);
    keypad(stdscr, true);
+   // Lets the terminal move the lines of panels scrolling
+   idlok(stdscr, true);
 #ifdef HAVE_MOUSEINTERVAL
    mouseinterval(0);
 #endif
@@ -1198,16 +1203,19 @@ void __attribute__((__noreturn__)) CRT_fatalError(const char *note, int e) {
    exit(2);
 }
 
-static bool explicit_delay_mode = false;
+static bool poll_mode = false;
 
-void CRT_setExplicitDelay(bool enabled) {
-	explicit_delay_mode = enabled;
-	if(enabled) {
-		nocbreak();
-		cbreak();
-		nodelay(stdscr, true);
-	} // else call CRT_enableDelay afterward
-}
+// Descriptors CRT_getKey watches besides the terminal
+#define CRT_MAX_WATCHED_FDS 8
+
+typedef struct CRT_WatchedFd_ {
+   int fd;
+   CRT_FdHandler handler;
+   void* data;
+} CRT_WatchedFd;
+
+static CRT_WatchedFd CRT_watchedFds[CRT_MAX_WATCHED_FDS];
+static int CRT_watchedFdCount = 0;
 
 // Wait a key forever
 int CRT_readKey() {
@@ -1215,30 +1223,81 @@ int CRT_readKey() {
    cbreak();
    nodelay(stdscr, FALSE);
    int k = getch();
-   if(explicit_delay_mode) nodelay(stdscr, true);
-   else halfdelay(CRT_delay);
+   poll_mode = false;
+   halfdelay(CRT_delay);
    return k;
 }
 
 void CRT_disableDelay() {
-   if(explicit_delay_mode) return;
+   poll_mode = false;
    nocbreak();
    cbreak();
    nodelay(stdscr, TRUE);
 }
 
 void CRT_enableDelay() {
-   if(explicit_delay_mode) return;
+   poll_mode = false;
    halfdelay(CRT_delay);
 }
 
-void CRT_explicitDelay() {
-	if(!explicit_delay_mode) return;
-	fd_set rfdset;
-	FD_ZERO(&rfdset);
-	FD_SET(STDIN_FILENO, &rfdset);
-	struct timeval timeout = { .tv_sec = CRT_delay / 10, .tv_usec = CRT_delay % 10 * 100000 };
-	select(STDIN_FILENO + 1, &rfdset, NULL, NULL, &timeout);
+/*
+ * Has CRT_getKey return when fd becomes readable as well, after calling
+ * handler if there is one.
+ */
+void CRT_watchFd(int fd, CRT_FdHandler handler, void* data) {
+   int i;
+   for (i = 0; i < CRT_watchedFdCount; i++) {
+      if (CRT_watchedFds[i].fd == fd) break;
+   }
+   if (i == CRT_MAX_WATCHED_FDS) return;
+   if (i == CRT_watchedFdCount) CRT_watchedFdCount++;
+   CRT_watchedFds[i].fd = fd;
+   CRT_watchedFds[i].handler = handler;
+   CRT_watchedFds[i].data = data;
+}
+
+void CRT_unwatchFd(int fd) {
+   for (int i = 0; i < CRT_watchedFdCount; i++) {
+      if (CRT_watchedFds[i].fd == fd) {
+         CRT_watchedFds[i] = CRT_watchedFds[--CRT_watchedFdCount];
+         return;
+      }
+   }
+}
+
+/*
+ * Waits up to timeout milliseconds, or as long as it takes if negative, for
+ * a key or a watched descriptor. Returns the key, or ERR if there was none.
+ */
+int CRT_getKey(int timeout) {
+   if (!poll_mode) {
+      nocbreak();
+      cbreak();
+      nodelay(stdscr, TRUE);
+      poll_mode = true;
+   }
+   // Keys may already have been read from the terminal by curses
+   int ch = getch();
+   if (ch != ERR) return ch;
+
+   // The handlers may change the watched descriptors
+   CRT_WatchedFd watched[CRT_MAX_WATCHED_FDS];
+   struct pollfd fds[CRT_MAX_WATCHED_FDS + 1];
+   int count = CRT_watchedFdCount;
+   memcpy(watched, CRT_watchedFds, count * sizeof(CRT_WatchedFd));
+   fds[0].fd = STDIN_FILENO;
+   fds[0].events = POLLIN;
+   for (int i = 0; i < count; i++) {
+      fds[i + 1].fd = watched[i].fd;
+      fds[i + 1].events = POLLIN;
+   }
+   // When interrupted, as by SIGWINCH, curses may have a key to return
+   if (poll(fds, count + 1, timeout) > 0) {
+      for (int i = 0; i < count; i++) {
+         if (fds[i + 1].revents && watched[i].handler) watched[i].handler(watched[i].data);
+      }
+   }
+   return getch();
 }
 
 void CRT_setColors(int color_scheme_i) {
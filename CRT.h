@@ -106,6 +106,8 @@ typedef enum {
 
 #define KEY_ALT(x) (KEY_F(64 - 26) + ((x) - 'A'))
 
+typedef void(*CRT_FdHandler)(void*);
+
 
 #ifndef __ANDROID__
 #endif
@@ -240,7 +242,9 @@ void CRT_done();
 
 void __attribute__((__noreturn__)) CRT_fatalError(const char *note, int e);
 
-void CRT_setExplicitDelay(bool enabled);
+// Descriptors CRT_getKey watches besides the terminal
+#define CRT_MAX_WATCHED_FDS 8
+
 
 // Wait a key forever
 int CRT_readKey();
@@ -249,7 +253,19 @@ void CRT_disableDelay();
 
 void CRT_enableDelay();
 
-void CRT_explicitDelay();
+/*
+ * Has CRT_getKey return when fd becomes readable as well, after calling
+ * handler if there is one.
+ */
+void CRT_watchFd(int fd, CRT_FdHandler handler, void* data);
+
+void CRT_unwatchFd(int fd);
+
+/*
+ * Waits up to timeout milliseconds, or as long as it takes if negative, for
+ * a key or a watched descriptor. Returns the key, or ERR if there was none.
+ */
+int CRT_getKey(int timeout);
 
 void CRT_setColors(int color_scheme_i);
 
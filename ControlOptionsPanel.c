@@ -91,6 +91,9 @@ ControlOptionsPanel* ControlOptionsPanel_new(Settings* settings, ScreenManager*
    if(!settings->disk_mode) {
 #endif
       Panel_add(super, (Object *)CheckItem_newByRef(xStrdup("Update process names on CTRL-L"), &settings->update_process_names_on_ctrl_l));
+#ifdef HAVE_LINUX_CN_PROC_H
+      Panel_add(super, (Object *)CheckItem_newByRef(xStrdup("Track process creation and exit via proc connector (needs root)"), &settings->use_proc_events));
+#endif
 #ifdef DISK_STATS
    }
 #endif
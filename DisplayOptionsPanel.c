@@ -94,6 +94,7 @@ DisplayOptionsPanel* DisplayOptionsPanel_new(Settings* settings, ScreenManager*
    if(!settings->disk_mode) {
 #endif
    Panel_add(super, (Object*) CheckItem_newByRef(xStrdup("Tree view"), &(settings->treeView)));
+   Panel_add(super, (Object*) CheckItem_newByRef(xStrdup("Sort siblings by the sort key in tree view"), &(settings->tree_sort_siblings)));
    Panel_add(super, (Object*) CheckItem_newByRef(xStrdup("Shadow other users' processes"), &(settings->shadowOtherUsers)));
    Panel_add(super, (Object*) CheckItem_newByRef(xStrdup("Hide kernel processes"), &(settings->hide_kernel_processes)));
 #ifdef PLATFORM_PRESENT_THREADS_AS_PROCESSES
@@ -122,6 +123,5 @@ DisplayOptionsPanel* DisplayOptionsPanel_new(Settings* settings, ScreenManager*
    Panel_add(super, (Object*) CheckItem_newByRef(xStrdup("Add guest time in CPU meter percentage"), &(settings->accountGuestInCPUMeter)));
    this->case_insensitive_sort_check_item = CheckItem_newByVal(xStrdup("Case-insensitive sort"), settings->sort_strcmp == strcasecmp);
    Panel_add(super, (Object *)this->case_insensitive_sort_check_item);
-   Panel_add(super, (Object *)CheckItem_newByRef(xStrdup("Explicitly delay between updates to workaround a ncurses issue"), &settings->explicit_delay));
    return this;
 }
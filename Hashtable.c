@@ -20,148 +20,221 @@ typedef void(*Hashtable_PairFunction)(int, void*, void*);
 
 typedef struct HashtableItem {
    unsigned int key;
+   bool used;
+   // Only set in the buckets being moved out by an incremental rehash
+   bool deleted;
    void* value;
-   struct HashtableItem* next;
 } HashtableItem;
 
+// Open addressing table with linear probing. When it gets too full, the
+// buckets are doubled and the items moved over a few at a time by the
+// following Hashtable_put and Hashtable_remove calls.
 struct Hashtable_ {
    int size;
-   HashtableItem** buckets;
+   HashtableItem* buckets;
    int items;
    bool owner;
+   // Previous buckets while rehashing, NULL otherwise
+   HashtableItem* old_buckets;
+   int old_size;
+   int rehash_index;
 };
 }*/
 
-#ifndef NDEBUG
+// Maximum load of the buckets, in eighths
+#define HASHTABLE_MAX_LOAD 6
 
-static bool Hashtable_isConsistent(const Hashtable *this) {
-   int items = 0;
-   for (int i = 0; i < this->size; i++) {
-      const HashtableItem *bucket = this->buckets[i];
-      while (bucket) {
-         items++;
-         bucket = bucket->next;
-      }
-   }
-   return items == this->items;
+// Old buckets moved per modification while rehashing
+#define HASHTABLE_REHASH_STEP 8
+
+static inline unsigned int Hashtable_hash(unsigned int key) {
+   key ^= key >> 16;
+   key *= 0x45d9f3bU;
+   key ^= key >> 16;
+   key *= 0x45d9f3bU;
+   key ^= key >> 16;
+   return key;
 }
 
+#ifndef NDEBUG
+
 int Hashtable_count(const Hashtable *this) {
    int items = 0;
    for (int i = 0; i < this->size; i++) {
-      const HashtableItem *bucket = this->buckets[i];
-      while (bucket) {
-         items++;
-         bucket = bucket->next;
+      if (this->buckets[i].used) items++;
+   }
+   if (this->old_buckets) {
+      for (int i = this->rehash_index; i < this->old_size; i++) {
+         if (this->old_buckets[i].used && !this->old_buckets[i].deleted) items++;
       }
    }
-   assert(items == this->items);
    return items;
 }
 
+static bool Hashtable_isConsistent(const Hashtable *this) {
+   return Hashtable_count(this) == this->items;
+}
+
 #endif
 
-static HashtableItem* HashtableItem_new(unsigned int key, void* value) {
-   HashtableItem *this = xMalloc(sizeof(HashtableItem));
-   this->key = key;
-   this->value = value;
-   this->next = NULL;
-   return this;
+static HashtableItem* Hashtable_findIn(HashtableItem* buckets, int size, unsigned int key) {
+   unsigned int mask = size - 1;
+   unsigned int index = Hashtable_hash(key) & mask;
+   while (buckets[index].used) {
+      if (buckets[index].key == key && !buckets[index].deleted) return buckets + index;
+      index = (index + 1) & mask;
+   }
+   return NULL;
+}
+
+static inline HashtableItem* Hashtable_find(const Hashtable* this, unsigned int key) {
+   HashtableItem* item = Hashtable_findIn(this->buckets, this->size, key);
+   if (!item && this->old_buckets) {
+      item = Hashtable_findIn(this->old_buckets, this->old_size, key);
+   }
+   return item;
+}
+
+static void Hashtable_insert(Hashtable* this, unsigned int key, void* value) {
+   // Only called with a key that isn't in the buckets yet
+   unsigned int mask = this->size - 1;
+   unsigned int index = Hashtable_hash(key) & mask;
+   while (this->buckets[index].used) {
+      index = (index + 1) & mask;
+   }
+   HashtableItem* item = this->buckets + index;
+   item->key = key;
+   item->value = value;
+   item->used = true;
+}
+
+static void Hashtable_clearBucket(Hashtable* this, unsigned int i) {
+   // Empties a bucket of the current buckets, moving back the items that
+   // follow it so no probe sequence is broken.
+   unsigned int mask = this->size - 1;
+   unsigned int j = i;
+   while (true) {
+      j = (j + 1) & mask;
+      if (!this->buckets[j].used) break;
+      unsigned int home = Hashtable_hash(this->buckets[j].key) & mask;
+      if (i <= j ? (i < home && home <= j) : (i < home || home <= j)) continue;
+      this->buckets[i] = this->buckets[j];
+      i = j;
+   }
+   this->buckets[i].used = false;
+}
+
+static void Hashtable_rehashStep(Hashtable* this, int count) {
+   if (!this->old_buckets) return;
+   while (count-- > 0 && this->rehash_index < this->old_size) {
+      HashtableItem* item = this->old_buckets + this->rehash_index++;
+      if (item->used && !item->deleted) {
+         Hashtable_insert(this, item->key, item->value);
+         // Moved items may still be in the probe sequence of others
+         item->deleted = true;
+      }
+   }
+   if (this->rehash_index >= this->old_size) {
+      free(this->old_buckets);
+      this->old_buckets = NULL;
+      this->old_size = 0;
+   }
+}
+
+static void Hashtable_grow(Hashtable* this) {
+   // Finish a rehash still in progress before starting another
+   Hashtable_rehashStep(this, this->old_size);
+   this->old_buckets = this->buckets;
+   this->old_size = this->size;
+   this->rehash_index = 0;
+   this->size *= 2;
+   this->buckets = (HashtableItem*) xCalloc(this->size, sizeof(HashtableItem));
 }
 
 Hashtable* Hashtable_new(int size, bool owner) {
    Hashtable *this = xMalloc(sizeof(Hashtable));
    this->items = 0;
-   this->size = size;
-   this->buckets = (HashtableItem**) xCalloc(size, sizeof(HashtableItem*));
+   this->size = 8;
+   while (this->size < size) this->size *= 2;
+   this->buckets = (HashtableItem*) xCalloc(this->size, sizeof(HashtableItem));
    this->owner = owner;
+   this->old_buckets = NULL;
+   this->old_size = 0;
+   this->rehash_index = 0;
    assert(Hashtable_isConsistent(this));
    return this;
 }
 
 void Hashtable_delete(Hashtable* this) {
    assert(Hashtable_isConsistent(this));
-   for (int i = 0; i < this->size; i++) {
-      HashtableItem* walk = this->buckets[i];
-      while (walk != NULL) {
-         if (this->owner)
-            free(walk->value);
-         HashtableItem* savedWalk = walk;
-         walk = savedWalk->next;
-         free(savedWalk);
+   if (this->owner) {
+      for (int i = 0; i < this->size; i++) {
+         if (this->buckets[i].used) free(this->buckets[i].value);
+      }
+      for (int i = this->rehash_index; i < this->old_size; i++) {
+         const HashtableItem* item = this->old_buckets + i;
+         if (item->used && !item->deleted) free(item->value);
       }
    }
+   free(this->old_buckets);
    free(this->buckets);
    free(this);
 }
 
 void Hashtable_put(Hashtable* this, unsigned int key, void* value) {
-   unsigned int index = key % this->size;
-   HashtableItem** bucketPtr = &(this->buckets[index]);
-   while (true)
-      if (*bucketPtr == NULL) {
-         *bucketPtr = HashtableItem_new(key, value);
-         this->items++;
-         break;
-      } else if ((*bucketPtr)->key == key) {
-         if (this->owner)
-            free((*bucketPtr)->value);
-         (*bucketPtr)->value = value;
-         break;
-      } else
-         bucketPtr = &((*bucketPtr)->next);
+   HashtableItem* item = Hashtable_find(this, key);
+   if (item) {
+      if (this->owner)
+         free(item->value);
+      item->value = value;
+   } else {
+      if ((this->items + 1) * 8 > this->size * HASHTABLE_MAX_LOAD)
+         Hashtable_grow(this);
+      Hashtable_insert(this, key, value);
+      this->items++;
+   }
+   Hashtable_rehashStep(this, HASHTABLE_REHASH_STEP);
    assert(Hashtable_isConsistent(this));
 }
 
 void* Hashtable_remove(Hashtable* this, unsigned int key) {
-   unsigned int index = key % this->size;
    assert(Hashtable_isConsistent(this));
-
-   HashtableItem **bucket = this->buckets + index;
-   while(*bucket) {
-      if ((*bucket)->key == key) {
-         void* value = (*bucket)->value;
-         HashtableItem* next = (*bucket)->next;
-         free(*bucket);
-         (*bucket) = next;
-         this->items--;
-         if (this->owner) {
-            free(value);
-            assert(Hashtable_isConsistent(this));
-            return NULL;
-         } else {
-            assert(Hashtable_isConsistent(this));
-            return value;
-         }
-      }
-      bucket = &(*bucket)->next;
+   void* value;
+   HashtableItem* item = Hashtable_findIn(this->buckets, this->size, key);
+   if (item) {
+      value = item->value;
+      Hashtable_clearBucket(this, item - this->buckets);
+   } else if (this->old_buckets && (item = Hashtable_findIn(this->old_buckets, this->old_size, key))) {
+      // Keep the bucket used, so later items in its probe sequence are found
+      value = item->value;
+      item->deleted = true;
+   } else {
+      return NULL;
    }
+   this->items--;
+   Hashtable_rehashStep(this, HASHTABLE_REHASH_STEP);
    assert(Hashtable_isConsistent(this));
-   return NULL;
+   if (this->owner) {
+      free(value);
+      return NULL;
+   }
+   return value;
 }
 
 inline void* Hashtable_get(const Hashtable *this, unsigned int key) {
-   unsigned int index = key % this->size;
-   const HashtableItem *bucketPtr = this->buckets[index];
-   while (true) {
-      if (bucketPtr == NULL) {
-         assert(Hashtable_isConsistent(this));
-         return NULL;
-      } else if (bucketPtr->key == key) {
-         assert(Hashtable_isConsistent(this));
-         return bucketPtr->value;
-      } else bucketPtr = bucketPtr->next;
-   }
+   const HashtableItem* item = Hashtable_find(this, key);
+   return item ? item->value : NULL;
 }
 
 void Hashtable_foreach(const Hashtable *this, Hashtable_PairFunction f, void* userData) {
    assert(Hashtable_isConsistent(this));
    for (int i = 0; i < this->size; i++) {
-      const HashtableItem *walk = this->buckets[i];
-      while (walk != NULL) {
-         f(walk->key, walk->value, userData);
-         walk = walk->next;
-      }
+      const HashtableItem* item = this->buckets + i;
+      if (item->used) f(item->key, item->value, userData);
+   }
+   for (int i = this->rehash_index; i < this->old_size; i++) {
+      const HashtableItem* item = this->old_buckets + i;
+      if (item->used && !item->deleted) f(item->key, item->value, userData);
    }
    assert(Hashtable_isConsistent(this));
 }
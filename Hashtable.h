@@ -17,17 +17,32 @@ typedef void(*Hashtable_PairFunction)(int, void*, void*);
 
 typedef struct HashtableItem {
    unsigned int key;
+   bool used;
+   // Only set in the buckets being moved out by an incremental rehash
+   bool deleted;
    void* value;
-   struct HashtableItem* next;
 } HashtableItem;
 
+// Open addressing table with linear probing. When it gets too full, the
+// buckets are doubled and the items moved over a few at a time by the
+// following Hashtable_put and Hashtable_remove calls.
 struct Hashtable_ {
    int size;
-   HashtableItem** buckets;
+   HashtableItem* buckets;
    int items;
    bool owner;
+   // Previous buckets while rehashing, NULL otherwise
+   HashtableItem* old_buckets;
+   int old_size;
+   int rehash_index;
 };
 
+// Maximum load of the buckets, in eighths
+#define HASHTABLE_MAX_LOAD 6
+
+// Old buckets moved per modification while rehashing
+#define HASHTABLE_REHASH_STEP 8
+
 #ifndef NDEBUG
 
 int Hashtable_count(const Hashtable *this);
@@ -163,24 +163,81 @@ void Header_reinit(const Header *this) {
    }
 }
 
-void Header_draw(const Header* this) {
-   int height = this->height;
+static inline int Header_columnWidth(const Header* this) {
+   return (COLS + 1) / this->nrColumns - (this->pad * this->nrColumns - 1) - 1;
+}
+
+static void Header_drawMeters(const Header* this, bool all) {
    int pad = this->pad;
+   int width = Header_columnWidth(this);
+   int x = pad;
+   Header_forEachColumn(this, col) {
+      Vector* meters = this->columns[col];
+      for (int y = (pad / 2), i = 0; i < Vector_size(meters); i++) {
+         Meter* meter = (Meter*) Vector_get(meters, i);
+         if (all || meter->changed) {
+            meter->draw(meter, x, y, width);
+            meter->changed = false;
+         }
+         y += meter->h;
+      }
+      x += width + pad;
+   }
+}
+
+void Header_draw(const Header* this) {
    attrset(CRT_colors[HTOP_DEFAULT_COLOR]);
-   for (int y = 0; y < height; y++) {
+   for (int y = 0; y < this->height; y++) {
       mvhline(y, 0, ' ', COLS);
    }
-   int width = (COLS + 1) / this->nrColumns - (pad * this->nrColumns - 1) - 1;
+   Header_drawMeters(this, true);
+}
+
+// Only draws the meters whose values changed since they were last drawn
+void Header_drawChanged(const Header* this) {
+   int height = this->height;
+   int pad = this->pad;
+   int width = Header_columnWidth(this);
    int x = pad;
+   // Everything is cleared before drawing, out to the end of the next column
+   // where text running past a meter ends up. The meters of the next column
+   // on the cleared lines are then drawn again as well.
+   bool spilled[height + 1];
+   bool cleared[height + 1];
+   memset(spilled, 0, sizeof spilled);
+   attrset(CRT_colors[HTOP_DEFAULT_COLOR]);
    Header_forEachColumn(this, col) {
       Vector* meters = this->columns[col];
+      int clearWidth = col < this->nrColumns - 2 ? 2 * (width + pad) : COLS - x;
+      memset(cleared, 0, sizeof cleared);
       for (int y = (pad / 2), i = 0; i < Vector_size(meters); i++) {
          Meter* meter = (Meter*) Vector_get(meters, i);
-         meter->draw(meter, x, y, width);
+         int bottom = MIN(y + meter->h, height);
+         for (int line = y; !meter->changed && line < bottom; line++) {
+            if (spilled[line]) meter->changed = true;
+         }
+         if (meter->changed) {
+            for (int line = y; line < bottom; line++) {
+               mvhline(line, x, ' ', clearWidth);
+               cleared[line] = true;
+            }
+         }
          y += meter->h;
       }
+      memcpy(spilled, cleared, sizeof spilled);
       x += width + pad;
    }
+   Header_drawMeters(this, false);
+}
+
+// Passes a new sample on to the meters, see Meter_sample
+void Header_sample(const Header* this) {
+   Header_forEachColumn(this, col) {
+      Vector* meters = this->columns[col];
+      for (int i = 0; i < Vector_size(meters); i++) {
+         Meter_sample((Meter*) Vector_get(meters, i));
+      }
+   }
 }
 
 int Header_calculateHeight(Header* this) {
@@ -212,8 +269,6 @@ void Header_runSetup(Header *this, Settings *settings, const ProcessList *pl) {
    ScreenManager_delete(setup_scr);
    if (settings->changed) {
       CRT_setMouse(settings->use_mouse);
-      CRT_setExplicitDelay(settings->explicit_delay);
-      if(!settings->explicit_delay) CRT_enableDelay();
       Header_writeBackToSettings(this);
    }
 }
@@ -63,6 +63,12 @@ void Header_reinit(const Header *this);
 
 void Header_draw(const Header* this);
 
+// Only draws the meters whose values changed since they were last drawn
+void Header_drawChanged(const Header* this);
+
+// Passes a new sample on to the meters, see Meter_sample
+void Header_sample(const Header* this);
+
 int Header_calculateHeight(Header* this);
 
 void Header_runSetup(Header *this, Settings *settings, const ProcessList *pl);
@@ -27,3 +27,20 @@ ssize_t xread(int fd, void *buffer, size_t count) {
 	} while(count > 0);
 	return p - (char *)buffer;
 }
+
+// Like xread, but reads from the given offset without changing the file offset.
+ssize_t xpread(int fd, void *buffer, size_t count, off_t offset) {
+	char *p = buffer;
+	do {
+		ssize_t res = pread(fd, p, count, offset);
+		if (res == -1) {
+			if(errno == EINTR) continue;
+			return -1;
+		}
+		if (count == 0 || res == 0) return p - (char *)buffer;
+		p += res;
+		offset += res;
+		count -= res;
+	} while(count > 0);
+	return p - (char *)buffer;
+}
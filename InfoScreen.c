@@ -136,8 +136,8 @@ void InfoScreen_run(InfoScreen* this) {
       if (this->inc->active) {
          (void) move(LINES-1, CRT_cursorX);
       }
-      CRT_explicitDelay();
-      int ch = getch();
+      // Screens with something to update get back to it every delay
+      int ch = CRT_getKey(As_InfoScreen(this)->onErr ? CRT_delay * 100 : -1);
       if (ch == ERR) {
          if (As_InfoScreen(this)->onErr) {
             InfoScreen_onErr(this);
@@ -58,6 +58,7 @@ void MainPanel_updateTreeFunctions(MainPanel* this, bool mode) {
 
 void MainPanel_pidSearch(MainPanel* this, int ch) {
    Panel* super = (Panel*) this;
+   ProcessList_completeSort(this->state->pl);
    pid_t pid = ch-48 + this->pidSearch;
    for (int i = 0; i < Panel_size(super); i++) {
       Process* p = (Process*) Panel_get(super, i);
@@ -132,6 +133,10 @@ static HandlerResult MainPanel_eventHandler(Panel* super, int ch, int repeat) {
       ProcessList_printHeader(this->state->pl, Panel_getHeader(super));
    }
    if (reaction & HTOP_REFRESH) {
+      // Actions may have changed anything shown in the lines, or drawn
+      // over them
+      Process_invalidateDisplay();
+      Panel_invalidateLines(super);
       result |= REDRAW;
    }
    if (reaction & HTOP_RECALCULATE) {
@@ -147,6 +152,7 @@ static HandlerResult MainPanel_eventHandler(Panel* super, int ch, int repeat) {
       this->state->pl->following = -1;
       Panel_setSelectionColor(super, CRT_colors[HTOP_PANEL_SELECTION_FOCUS_COLOR]);
    }
+   this->state->pl->sortAll = this->inc->active != NULL;
    return result;
 }
 
@@ -208,6 +214,7 @@ PanelClass MainPanel_class = {
 MainPanel* MainPanel_new() {
    MainPanel* this = AllocThis(MainPanel);
    Panel_init((Panel*) this, 1, 1, 1, 1, Class(Process), false, FunctionBar_new(MainFunctions, NULL, NULL));
+   Panel_setLineCache((Panel*) this, true);
    this->keys = xCalloc(KEY_MAX, sizeof(Htop_Action));
    this->inc = IncSet_new(MainPanel_getFunctionBar(this));
 
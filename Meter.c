@@ -20,6 +20,7 @@ typedef void(*Meter_Done)(Meter*);
 typedef void(*Meter_UpdateMode)(Meter*, int);
 typedef void(*Meter_UpdateValues)(Meter*, char*, int);
 typedef void(*Meter_Draw)(Meter*, int, int, int);
+typedef void(*Meter_Sample)(Meter*);
 typedef double (*MeterGetDoubleFunction)(Meter *);
 typedef int (*MeterGetAttributeFunction)(Meter *, int);
 
@@ -29,6 +30,8 @@ typedef struct MeterClass_ {
    Meter_Done done;
    Meter_UpdateMode updateMode;
    Meter_Draw draw;
+   // Custom mode meters pass samples on to the meters they draw
+   Meter_Sample sample;
    Meter_UpdateValues updateValues;
    MeterGetDoubleFunction getMaximum;
    MeterGetAttributeFunction getAttribute;
@@ -56,6 +59,7 @@ typedef struct MeterClass_ {
 #define Meter_updateModeFn(this_)      As_Meter(this_)->updateMode
 #define Meter_updateMode(this_, m_)    As_Meter(this_)->updateMode((Meter*)(this_), (m_))
 #define Meter_drawFn(this_)            As_Meter(this_)->draw
+#define Meter_sampleFn(this_)          As_Meter(this_)->sample
 #define Meter_doneFn(this_)            As_Meter(this_)->done
 #define Meter_updateValues(this_, buf_, sz_) \
                                        As_Meter(this_)->updateValues((Meter*)(this_), (buf_), (sz_))
@@ -80,6 +84,10 @@ struct Meter_ {
    ProcessList *pl;
    double* values;
    double total;
+   // Hash of what the last sample would draw
+   unsigned long long sampled;
+   // Whether the meter needs drawing again since the last time it was drawn
+   bool changed;
 };
 
 typedef struct MeterMode_ {
@@ -97,9 +105,13 @@ typedef enum {
    LAST_METERMODE
 } MeterModeId;
 
+// Ring buffer of the last samples of a graph meter
 typedef struct GraphData_ {
-   struct timeval time;
-   double values[METER_BUFFER_LEN];
+   int size;
+   int count;
+   // Index of the oldest sample
+   int start;
+   double values[];
 } GraphData;
 
 }*/
@@ -260,6 +272,66 @@ void Meter_setMode(Meter* this, int modeIndex) {
       this->h = mode->h;
    }
    this->mode = modeIndex;
+   this->changed = true;
+}
+
+static GraphData* GraphData_get(Meter* this) {
+   if (!this->drawData) {
+      int size = this->pl->settings->graph_history_length;
+      if (size <= 0) size = METER_BUFFER_LEN;
+      GraphData* data = xCalloc(1, sizeof(GraphData) + size * sizeof(double));
+      data->size = size;
+      this->drawData = data;
+   }
+   return this->drawData;
+}
+
+static unsigned long long Meter_hash(unsigned long long hash, const void* data, size_t size) {
+   const unsigned char* bytes = data;
+   for (size_t i = 0; i < size; i++) {
+      hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+   }
+   return hash;
+}
+
+/*
+ * Adds the current values to the history of graphs, and marks the meter as
+ * changed when it would draw differently; called for every sample, including
+ * those taken between redraws.
+ */
+void Meter_sample(Meter* this) {
+   if (Meter_defaultMode(this) == CUSTOM_METERMODE) {
+      if (Meter_sampleFn(this)) Meter_sampleFn(this)(this);
+      else this->changed = true;
+      return;
+   }
+   char buffer[METER_BUFFER_LEN];
+   Meter_updateValues(this, buffer, METER_BUFFER_LEN);
+   int nitems = Meter_getItems(this);
+   double total = Meter_getMaximum(this);
+   if (this->mode != GRAPH_METERMODE) {
+      unsigned long long hash = Meter_hash(0xcbf29ce484222325ULL, buffer, strlen(buffer));
+      hash = Meter_hash(hash, this->values, nitems * sizeof(double));
+      hash = Meter_hash(hash, &total, sizeof total);
+      if (hash != this->sampled) {
+         this->sampled = hash;
+         this->changed = true;
+      }
+      return;
+   }
+   // Graphs move along with every sample
+   this->changed = true;
+   GraphData *data = GraphData_get(this);
+   double value = 0.0;
+   for (int i = 0; i < nitems; i++) value += this->values[i];
+   value /= total;
+   if (data->count < data->size) {
+      data->values[(data->start + data->count) % data->size] = value;
+      data->count++;
+   } else {
+      data->values[data->start] = value;
+      data->start = (data->start + 1) % data->size;
+   }
 }
 
 ListItem* Meter_toListItem(Meter* this, bool moving) {
@@ -426,11 +498,56 @@ static const char* const GraphMeterMode_dotsAscii[] = {
 static const char* const* GraphMeterMode_dots;
 static int GraphMeterMode_pixPerRow;
 
+static inline double GraphData_at(const GraphData* data, int age) {
+   // age samples before the newest one
+   return data->values[(data->start + data->count - 1 - age) % data->size];
+}
+
+static int GraphData_points(const GraphData* data, double* points, int columns, bool newest) {
+   // Fills the two points of each column of the graph, the newest in the last
+   // one. Unless only the newest samples should be shown, a history longer
+   // than the graph is split into one slice per column, drawn as its lowest
+   // and highest samples in the order they were taken, so short peaks and
+   // dips stay visible. Returns the first column with points.
+   int nPoints = columns * 2;
+   if (newest || data->size <= nPoints) {
+      int first = MAX(nPoints - data->size, 0) / 2 * 2;
+      for (int i = first; i < nPoints; i++) {
+         int age = nPoints - 1 - i;
+         points[i] = age < data->count ? GraphData_at(data, age) : 0.0;
+      }
+      return first / 2;
+   }
+   for (int k = 0; k < columns; k++) {
+      // Ages of the slice, from the oldest to past the newest
+      int from = (long long) (columns - k) * data->size / columns - 1;
+      int to = (long long) (columns - 1 - k) * data->size / columns - 1;
+      if (from >= data->count) from = data->count - 1;
+      if (from <= to) {
+         points[k*2] = points[k*2+1] = 0.0;
+         continue;
+      }
+      double lowest = GraphData_at(data, from), highest = lowest;
+      bool lowestFirst = true;
+      for (int age = from - 1; age > to; age--) {
+         double value = GraphData_at(data, age);
+         if (value < lowest) {
+            lowest = value;
+            lowestFirst = false;
+         } else if (value > highest) {
+            highest = value;
+            lowestFirst = true;
+         }
+      }
+      points[k*2] = lowestFirst ? lowest : highest;
+      points[k*2+1] = lowestFirst ? highest : lowest;
+   }
+   return 0;
+}
+
 static void GraphMeterMode_draw(Meter* this, int x, int y, int w) {
 
-   if (!this->drawData) this->drawData = xCalloc(1, sizeof(GraphData));
-   GraphData *data = this->drawData;
-   const int nValues = METER_BUFFER_LEN;
+   const GraphData *data = GraphData_get(this);
 
 #ifdef HAVE_LIBNCURSESW
    if (CRT_utf8) {
@@ -448,39 +565,14 @@ static void GraphMeterMode_draw(Meter* this, int x, int y, int w) {
    mvaddnstr(y, x, this->short_caption ? this->short_caption : this->caption, captionLen);
    x += captionLen;
    w -= captionLen;
-   struct timeval now;
-   gettimeofday(&now, NULL);
-   if (!timercmp(&now, &(data->time), <)) {
-      struct timeval delay = { .tv_sec = CRT_delay/10, .tv_usec = (CRT_delay-((CRT_delay/10)*10)) * 100000 };
-#ifndef timeradd
-      data->time.tv_sec = now.tv_sec + delay.tv_sec;
-      data->time.tv_usec = now.tv_usec + delay.tv_usec;
-      if (data->time.tv_usec >= 1000000) {
-              data->time.tv_sec++;
-              data->time.tv_usec -= 1000000;
-      }
-#else
-      timeradd(&now, &delay, &(data->time));
-#endif
-
-      for (int i = 0; i < nValues - 1; i++) data->values[i] = data->values[i+1];
-      char buffer[nValues];
-      Meter_updateValues(this, buffer, nValues);
-      double value = 0.0;
-      int nitems = Meter_getItems(this);
-      for (int i = 0; i < nitems; i++) value += this->values[i];
-      value /= Meter_getMaximum(this);
-      data->values[nValues - 1] = value;
-   }
-   int i = nValues - (w*2) + 2, k = 0;
-   if (i < 0) {
-      k = -i/2;
-      i = 0;
-   }
-   for (; i < nValues - 1; i+=2, k++) {
+   int columns = w - 1;
+   if (columns <= 0) return;
+   double points[columns * 2];
+   bool newest = this->pl->settings->graph_history_length == 0;
+   for (int k = GraphData_points(data, points, columns, newest); k < columns; k++) {
       int pix = GraphMeterMode_pixPerRow * GRAPH_HEIGHT;
-      int v1 = CLAMP((int) lround(data->values[i] * pix), 1, pix);
-      int v2 = CLAMP((int) lround(data->values[i+1] * pix), 1, pix);
+      int v1 = CLAMP((int) lround(points[k*2] * pix), 1, pix);
+      int v2 = CLAMP((int) lround(points[k*2+1] * pix), 1, pix);
 
       int colorIdx = HTOP_GRAPH_1_COLOR;
       for (int line = 0; line < GRAPH_HEIGHT; line++) {
@@ -23,6 +23,7 @@ typedef void(*Meter_Done)(Meter*);
 typedef void(*Meter_UpdateMode)(Meter*, int);
 typedef void(*Meter_UpdateValues)(Meter*, char*, int);
 typedef void(*Meter_Draw)(Meter*, int, int, int);
+typedef void(*Meter_Sample)(Meter*);
 typedef double (*MeterGetDoubleFunction)(Meter *);
 typedef int (*MeterGetAttributeFunction)(Meter *, int);
 
@@ -32,6 +33,8 @@ typedef struct MeterClass_ {
    Meter_Done done;
    Meter_UpdateMode updateMode;
    Meter_Draw draw;
+   // Custom mode meters pass samples on to the meters they draw
+   Meter_Sample sample;
    Meter_UpdateValues updateValues;
    MeterGetDoubleFunction getMaximum;
    MeterGetAttributeFunction getAttribute;
@@ -59,6 +62,7 @@ typedef struct MeterClass_ {
 #define Meter_updateModeFn(this_)      As_Meter(this_)->updateMode
 #define Meter_updateMode(this_, m_)    As_Meter(this_)->updateMode((Meter*)(this_), (m_))
 #define Meter_drawFn(this_)            As_Meter(this_)->draw
+#define Meter_sampleFn(this_)          As_Meter(this_)->sample
 #define Meter_doneFn(this_)            As_Meter(this_)->done
 #define Meter_updateValues(this_, buf_, sz_) \
                                        As_Meter(this_)->updateValues((Meter*)(this_), (buf_), (sz_))
@@ -83,6 +87,10 @@ struct Meter_ {
    ProcessList *pl;
    double* values;
    double total;
+   // Hash of what the last sample would draw
+   unsigned long long sampled;
+   // Whether the meter needs drawing again since the last time it was drawn
+   bool changed;
 };
 
 typedef struct MeterMode_ {
@@ -100,9 +108,13 @@ typedef enum {
    LAST_METERMODE
 } MeterModeId;
 
+// Ring buffer of the last samples of a graph meter
 typedef struct GraphData_ {
-   struct timeval time;
-   double values[METER_BUFFER_LEN];
+   int size;
+   int count;
+   // Index of the oldest sample
+   int start;
+   double values[];
 } GraphData;
 
 
@@ -135,6 +147,13 @@ void Meter_setShortCaption(Meter *this, const char *caption);
 
 void Meter_setMode(Meter* this, int modeIndex);
 
+/*
+ * Adds the current values to the history of graphs, and marks the meter as
+ * changed when it would draw differently; called for every sample, including
+ * those taken between redraws.
+ */
+void Meter_sample(Meter* this);
+
 ListItem* Meter_toListItem(Meter* this, bool moving);
 
 /* ---------- TextMeterMode ---------- */
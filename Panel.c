@@ -51,6 +51,13 @@ typedef struct PanelClass_ {
 #define Panel_placeCursor(this_) (As_Panel(this_)->placeCursor && (As_Panel(this_)->placeCursor(this_), true))
 #define Panel_onMouseSelect(this_,y_) As_Panel(this_)->onMouseSelect((this_), (y_))
 
+typedef struct PanelLine_ {
+   // Cells written from the item, -1 when the line has to be written again
+   int len;
+   // Attribute the rest of the line was cleared with
+   int attr;
+} PanelLine;
+
 struct Panel_ {
    Object super;
    int x, y, w, h;
@@ -69,6 +76,14 @@ struct Panel_ {
    int selectionColor;
    char repeat_number_buffer[11];
    unsigned int repeat_number_i;
+   // Content last written to each line, kept by the panels enabling it
+   // with Panel_setLineCache so unchanged lines aren't written again
+   bool lineCache;
+   PanelLine* lines;
+   CharType* lineCells;
+   int linesW;
+   int linesH;
+   int linesScrollV;
 };
 
 #define Panel_setDefaultBar(this_) do{ (this_)->currentBar = (this_)->defaultBar; }while(0)
@@ -105,6 +120,12 @@ struct Panel_ {
 
 #define KEY_CTRL(l) ((l)-'A'+1)
 
+#ifdef DEBUG
+// Totals of the lines written by Panel_draw, reported when htop exits
+unsigned long Panel_drawCount;
+unsigned long Panel_writtenLines;
+#endif
+
 static void base_Panel_onMouseSelect(Panel *this, int y) {
    Panel_setSelected(this, y - this->y + this->scrollV - 1);
 }
@@ -155,16 +176,45 @@ void Panel_init(Panel* this, int x, int y, int w, int h, ObjectClass* type, bool
    this->currentBar = fuBar;
    this->selectionColor = CRT_colors[HTOP_PANEL_SELECTION_FOCUS_COLOR];
    this->repeat_number_i = 0;
+   this->lineCache = false;
+   this->lines = NULL;
+   this->lineCells = NULL;
+   this->linesW = 0;
+   this->linesH = 0;
+   this->linesScrollV = 0;
 }
 
 void Panel_done(Panel* this) {
    assert (this != NULL);
+   free(this->lines);
+   free(this->lineCells);
    free(this->eventHandlerState);
    Vector_delete(this->items);
    FunctionBar_delete(this->defaultBar);
    RichString_end(this->header);
 }
 
+/*
+ * Makes Panel_draw remember what it writes to each line, and skip the
+ * lines already showing the same content. Panels enabling it must call
+ * Panel_invalidateLines whenever something else draws over them.
+ */
+void Panel_setLineCache(Panel* this, bool enabled) {
+   this->lineCache = enabled;
+   free(this->lines);
+   free(this->lineCells);
+   this->lines = NULL;
+   this->lineCells = NULL;
+   this->linesW = 0;
+   this->linesH = 0;
+}
+
+void Panel_invalidateLines(Panel* this) {
+   for (int i = 0; i < this->linesH; i++) {
+      this->lines[i].len = -1;
+   }
+}
+
 void Panel_setSelectionColor(Panel* this, int color) {
    this->selectionColor = color;
 }
@@ -187,6 +237,7 @@ void Panel_move(Panel* this, int x, int y) {
    this->x = x;
    this->y = y;
    this->needsRedraw = true;
+   Panel_invalidateLines(this);
 }
 
 void Panel_resize(Panel* this, int w, int h) {
@@ -196,6 +247,7 @@ void Panel_resize(Panel* this, int w, int h) {
    this->w = w;
    this->h = h;
    this->needsRedraw = true;
+   Panel_invalidateLines(this);
 }
 
 void Panel_setReservedHeight(Panel *this, int reserved_height) {
@@ -313,6 +365,65 @@ void Panel_setSelected(Panel* this, int selected) {
    }
 }
 
+static void Panel_prepareLines(Panel* this, int y, int h, int first) {
+   // Sizes the line cache for the panel, and moves it along when the panel
+   // scrolled by less than its height since the last draw. Panels as wide as
+   // the screen have the lines shifted on screen too, in a scroll region, so
+   // the terminal can move them instead of having them written again.
+   if (this->linesW != this->w || this->linesH != h) {
+      free(this->lines);
+      free(this->lineCells);
+      this->lines = xMalloc(MAX(h, 1) * sizeof(PanelLine));
+      this->lineCells = xMalloc(MAX(h * this->w, 1) * sizeof(CharType));
+      this->linesW = this->w;
+      this->linesH = h;
+      this->linesScrollV = first;
+      Panel_invalidateLines(this);
+      return;
+   }
+   int shift = first - this->linesScrollV;
+   this->linesScrollV = first;
+   if (shift == 0 || abs(shift) >= h || this->x != 0 || this->w != COLS) return;
+   scrollok(stdscr, true);
+   setscrreg(y, y + h - 1);
+   scrl(shift);
+   setscrreg(0, LINES - 1);
+   scrollok(stdscr, false);
+   int kept = h - abs(shift);
+   int from = shift > 0 ? shift : 0;
+   int to = shift > 0 ? 0 : -shift;
+   memmove(this->lines + to, this->lines + from, kept * sizeof(PanelLine));
+   memmove(this->lineCells + to * this->w, this->lineCells + from * this->w, kept * this->w * sizeof(CharType));
+   // The lines scrolled in are blank
+   for (int i = shift > 0 ? kept : 0; i < (shift > 0 ? h : -shift); i++) {
+      this->lines[i].len = -1;
+   }
+}
+
+static void Panel_drawLine(Panel* this, int line, int y, const RichString* item, int len, int attr) {
+   // Writes len cells of the string from the horizontal scroll offset to a
+   // line of the panel, clearing the rest of it with attr, unless the line
+   // cache tells that the line already shows exactly that.
+   len = MAX(len, 0);
+   const CharType* cells = item ? item->chptr + this->scrollH : NULL;
+   if (this->lineCache && line >= 0 && line < this->linesH) {
+      PanelLine* last = this->lines + line;
+      CharType* lastCells = this->lineCells + line * this->w;
+      if (last->len == len && last->attr == attr &&
+         (len == 0 || memcmp(lastCells, cells, len * sizeof(CharType)) == 0)) return;
+      last->len = len;
+      last->attr = attr;
+      if (len > 0) memcpy(lastCells, cells, len * sizeof(CharType));
+   }
+   attrset(attr);
+   mvhline(y, this->x, ' ', this->w);
+   if (len > 0) RichString_printoffnVal(*item, y, this->x, this->scrollH, len);
+   attrset(CRT_colors[HTOP_DEFAULT_COLOR]);
+#ifdef DEBUG
+   Panel_writtenLines++;
+#endif
+}
+
 void Panel_draw(Panel* this, bool focus) {
    assert (this != NULL);
 
@@ -323,6 +434,10 @@ void Panel_draw(Panel* this, bool focus) {
 
    assert(this->scrollH >= 0);
 
+#ifdef DEBUG
+   Panel_drawCount++;
+#endif
+
    int headerLen = RichString_sizeVal(this->header);
    if (headerLen > 0) {
       attrset(CRT_colors[
@@ -359,6 +474,9 @@ void Panel_draw(Panel* this, bool focus) {
 
    int selectionColor = focus ?
       this->selectionColor : CRT_colors[HTOP_PANEL_SELECTION_UNFOCUS_COLOR];
+   int defaultColor = CRT_colors[HTOP_DEFAULT_COLOR];
+
+   if (this->lineCache) Panel_prepareLines(this, y, h, first);
 
    if (this->needsRedraw) {
       int line = 0;
@@ -371,18 +489,15 @@ void Panel_draw(Panel* this, bool focus) {
          int amt = MIN(itemLen - this->scrollH, this->w);
          bool selected = (i == this->selected);
          if (selected) {
-            attrset(selectionColor);
             RichString_setAttr(&item, selectionColor);
             this->selectedLen = itemLen;
          }
-         mvhline(y + line, x, ' ', this->w);
-         if (amt > 0) RichString_printoffnVal(item, y + line, x, this->scrollH, amt);
-         if (selected) attrset(CRT_colors[HTOP_DEFAULT_COLOR]);
+         Panel_drawLine(this, line, y + line, &item, amt, selected ? selectionColor : defaultColor);
          RichString_end(item);
          line++;
       }
       while (line < h) {
-         mvhline(y + line, x, ' ', this->w);
+         Panel_drawLine(this, line, y + line, NULL, 0, defaultColor);
          line++;
       }
       this->needsRedraw = false;
@@ -398,19 +513,11 @@ void Panel_draw(Panel* this, bool focus) {
       Object_display(newObj, &new);
       int newLen = RichString_sizeVal(new);
       this->selectedLen = newLen;
-      mvhline(y+ this->oldSelected - first, x+0, ' ', this->w);
-      if (this->scrollH < oldLen) {
-         RichString_printoffnVal(old, y+this->oldSelected - first, x,
-            this->scrollH, MIN(oldLen - this->scrollH, this->w));
-      }
-      attrset(selectionColor);
-      mvhline(y+this->selected - first, x+0, ' ', this->w);
+      Panel_drawLine(this, this->oldSelected - first, y + this->oldSelected - first,
+         &old, MIN(oldLen - this->scrollH, this->w), defaultColor);
       RichString_setAttr(&new, selectionColor);
-      if (this->scrollH < newLen) {
-         RichString_printoffnVal(new, y+this->selected - first, x,
-            this->scrollH, MIN(newLen - this->scrollH, this->w));
-      }
-      attrset(CRT_colors[HTOP_DEFAULT_COLOR]);
+      Panel_drawLine(this, this->selected - first, y + this->selected - first,
+         &new, MIN(newLen - this->scrollH, this->w), selectionColor);
       RichString_end(new);
       RichString_end(old);
    }
@@ -52,6 +52,13 @@ typedef struct PanelClass_ {
 #define Panel_placeCursor(this_) (As_Panel(this_)->placeCursor && (As_Panel(this_)->placeCursor(this_), true))
 #define Panel_onMouseSelect(this_,y_) As_Panel(this_)->onMouseSelect((this_), (y_))
 
+typedef struct PanelLine_ {
+   // Cells written from the item, -1 when the line has to be written again
+   int len;
+   // Attribute the rest of the line was cleared with
+   int attr;
+} PanelLine;
+
 struct Panel_ {
    Object super;
    int x, y, w, h;
@@ -70,6 +77,14 @@ struct Panel_ {
    int selectionColor;
    char repeat_number_buffer[11];
    unsigned int repeat_number_i;
+   // Content last written to each line, kept by the panels enabling it
+   // with Panel_setLineCache so unchanged lines aren't written again
+   bool lineCache;
+   PanelLine* lines;
+   CharType* lineCells;
+   int linesW;
+   int linesH;
+   int linesScrollV;
 };
 
 #define Panel_setDefaultBar(this_) do{ (this_)->currentBar = (this_)->defaultBar; }while(0)
@@ -92,6 +107,12 @@ struct Panel_ {
 
 #define KEY_CTRL(l) ((l)-'A'+1)
 
+#ifdef DEBUG
+// Totals of the lines written by Panel_draw, reported when htop exits
+extern unsigned long Panel_drawCount;
+extern unsigned long Panel_writtenLines;
+#endif
+
 extern PanelClass Panel_class;
 
 Panel* Panel_new(int x, int y, int w, int h, bool owner, ObjectClass* type, FunctionBar* fuBar);
@@ -102,6 +123,15 @@ void Panel_init(Panel* this, int x, int y, int w, int h, ObjectClass* type, bool
 
 void Panel_done(Panel* this);
 
+/*
+ * Makes Panel_draw remember what it writes to each line, and skip the
+ * lines already showing the same content. Panels enabling it must call
+ * Panel_invalidateLines whenever something else draws over them.
+ */
+void Panel_setLineCache(Panel* this, bool enabled);
+
+void Panel_invalidateLines(Panel* this);
+
 void Panel_setSelectionColor(Panel* this, int color);
 
 RichString* Panel_getHeader(Panel* this);
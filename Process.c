@@ -24,6 +24,8 @@ in the source distribution for its full text.
 #include <time.h>
 #include <stdio.h>
 #include <math.h>
+#include <ctype.h>
+#include <strings.h>
 #include <assert.h>
 #ifdef MAJOR_IN_MKDEV
 #include <sys/mkdev.h>
@@ -46,11 +48,22 @@ in the source distribution for its full text.
 #include "FieldData.h"
 #include <sys/types.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #define uintcmp(n1,n2) ((n1)>(n2)?1:((n1)<(n2)?-1:0))
 
+// Maps signed values to sort keys in the same order
+#define Process_signedSortKey(value_) ((uint64_t)(int64_t)(value_) ^ (UINT64_C(1) << 63))
+
 #define PROCESS_FLAG_IO 0x0001
 
+// Reasons for Process_display to format the line again
+#define PROCESS_DIRTY_VALUES 0x0001
+#define PROCESS_DIRTY_TREE 0x0002
+#define PROCESS_DIRTY_TAG 0x0004
+// Columns with values summed over the process subtree
+#define PROCESS_FLAG_SUBTREE 0x0002
+
 typedef enum {
    HTOP_NULL_PROCESSFIELD = 0,
    HTOP_PID_FIELD = 1,
@@ -98,8 +111,33 @@ typedef struct Process_ {
    bool showChildren;
    bool show;
    bool seen_in_tree_loop;
+   // Set when drawn on screen, cleared by the platform scan
+   bool displayed;
+   // Whether the command and PID pass the ProcessList filters, valid while
+   // filterGeneration is the list's; platforms reset it to 0 when the
+   // command changes
+   bool filterMatch;
+   unsigned int filterGeneration;
+   // Line last formatted by Process_display, reused by later redraws while
+   // no PROCESS_DIRTY_* bit is set and displayGeneration is still the
+   // current one; see Process_invalidateDisplay
+   CharType* displayLine;
+   int displayLineLen;
+   int displayLineSize;
+   unsigned int displayDirty;
+   unsigned int displayGeneration;
    int indent;
 
+   // Process tree kept by ProcessList across scans; siblings are linked in
+   // descending PID order
+   struct Process_* treeParent;
+   struct Process_* treeFirstChild;
+   struct Process_* treeNextSibling;
+   struct Process_* treePrevSibling;
+   pid_t treeParentPid;
+   bool treeLinked;
+   unsigned int treeGeneration;
+
    int state;
    pid_t pid;
    pid_t ppid;
@@ -125,6 +163,11 @@ typedef struct Process_ {
    float percent_cpu;
    float percent_mem;
 
+   // Totals for the process and its descendants in the tree, updated by
+   // ProcessList_scan when a PROCESS_FLAG_SUBTREE column is used
+   float subtree_percent_cpu;
+   long int subtree_m_resident;
+
    long int priority;
    long int nice;
    long int nlwp;
@@ -151,12 +194,31 @@ typedef Process*(*Process_New)(struct Settings_*);
 typedef void (*ProcessWriteFieldFunction)(const Process *, RichString *, ProcessField);
 typedef bool (*ProcessSendSignalFunction)(const Process *, int);
 typedef bool (*ProcessGetBooleanFunction)(const Process *);
+typedef void (*ProcessAddSubtreeFunction)(Process *, const Process *);
+
+typedef enum {
+   PROCESS_SORT_KEY_NONE,
+   PROCESS_SORT_KEY_EXACT,
+   // Processes with equal keys still have to be ordered with the compare
+   // function
+   PROCESS_SORT_KEY_PARTIAL
+} ProcessSortKeyKind;
+
+typedef ProcessSortKeyKind (*ProcessGetSortKeyFunction)(const Process *, ProcessField, uint64_t *);
 
 typedef struct ProcessClass_ {
    ObjectClass super;
    ProcessWriteFieldFunction writeField;
    ProcessSendSignalFunction sendSignal;
    ProcessGetBooleanFunction isSelf;
+   // Resets the subtree totals to the process's own values when the child
+   // is NULL, otherwise adds the totals of the child
+   ProcessAddSubtreeFunction addSubtree;
+   // Gets a key ordering processes as the compare function does when
+   // sorting in ascending direction. Not inherited, as subclasses may
+   // compare the generic fields differently; base_Process_getSortKey
+   // covers those of Process_compare
+   ProcessGetSortKeyFunction getSortKey;
 } ProcessClass;
 
 #define As_Process(this_)              ((ProcessClass*)((this_)->super.klass))
@@ -169,6 +231,7 @@ typedef struct ProcessClass_ {
 #define Process_isChildOf(process_, pid_) ((process_)->tgid == (pid_) || ((process_)->tgid == (process_)->pid && (process_)->ppid == (pid_)))
 #endif
 #define Process_isSelf(this_) (As_Process(this_)->isSelf(this_))
+#define Process_addSubtree(this_, child_) (As_Process(this_)->addSubtree((this_), (child_)))
 #define Process_sortState(state) ((state) == 'I' ? 0x100 : (state))
 
 }*/
@@ -187,6 +250,16 @@ char Process_pidFormat[20] = "%7d ";
 
 static char Process_titleBuffer[20][20];
 
+static unsigned int Process_displayGeneration = 1; // 0 marks processes never displayed
+
+/*
+ * Makes every process format its line again on the next display, after a
+ * change of the settings, colors or column widths.
+ */
+void Process_invalidateDisplay() {
+   if (++Process_displayGeneration == 0) Process_displayGeneration = 1;
+}
+
 void Process_setupColumnWidths() {
    int maxPid = Platform_getMaxPid();
    if (maxPid == -1) return;
@@ -198,6 +271,7 @@ void Process_setupColumnWidths() {
       Process_fields[Process_pidColumns[i].id].title = Process_titleBuffer[i];
    }
    xSnprintf(Process_pidFormat, sizeof(Process_pidFormat), "%%%dd ", digits);
+   Process_invalidateDisplay();
 }
 
 void Process_humanNumber(RichString* str, unsigned long number, bool coloring) {
@@ -387,6 +461,20 @@ static void copy_fixed_width_field(char *buffer, size_t buffer_size, const char
    }
 }
 
+// Returns the color to print the value in
+int Process_printPercentCpu(float percent_cpu, char* buffer, int n) {
+   if (percent_cpu > 999.9) {
+      xSnprintf(buffer, n, "%4u ", (unsigned int)percent_cpu);
+      return CRT_colors[HTOP_HIGH_PERCENT_COLOR];
+   }
+   if (percent_cpu > 99.9) {
+      xSnprintf(buffer, n, "%3u. ", (unsigned int)percent_cpu);
+      return CRT_colors[HTOP_MEDIUM_PERCENT_COLOR];
+   }
+   xSnprintf(buffer, n, "%4.1f ", percent_cpu);
+   return CRT_colors[HTOP_DEFAULT_COLOR];
+}
+
 void Process_writeField(const Process *this, RichString* str, ProcessField field) {
    char buffer[256]; buffer[255] = '\0';
    int attr = CRT_colors[HTOP_DEFAULT_COLOR];
@@ -397,15 +485,7 @@ void Process_writeField(const Process *this, RichString* str, ProcessField field
    switch (field) {
          struct tm tm;
       case HTOP_PERCENT_CPU_FIELD:
-         if (this->percent_cpu > 999.9) {
-            attr = CRT_colors[HTOP_HIGH_PERCENT_COLOR];
-            xSnprintf(buffer, n, "%4u ", (unsigned int)this->percent_cpu);
-         } else if (this->percent_cpu > 99.9) {
-            attr = CRT_colors[HTOP_MEDIUM_PERCENT_COLOR];
-            xSnprintf(buffer, n, "%3u. ", (unsigned int)this->percent_cpu);
-         } else {
-            xSnprintf(buffer, n, "%4.1f ", this->percent_cpu);
-         }
+         attr = Process_printPercentCpu(this->percent_cpu, buffer, n);
          break;
       case HTOP_PERCENT_MEM_FIELD:
          if (this->percent_mem > 99.9) {
@@ -577,8 +657,34 @@ void Process_writeField(const Process *this, RichString* str, ProcessField field
    RichString_append(str, attr, buffer);
 }
 
+static void Process_storeDisplayLine(Process* this, const RichString* line) {
+   int len = RichString_sizeVal(*line);
+   if (len > this->displayLineSize) {
+      free(this->displayLine);
+      this->displayLine = xMalloc(len * sizeof(CharType));
+      this->displayLineSize = len;
+   }
+   memcpy(this->displayLine, line->chptr, len * sizeof(CharType));
+   this->displayLineLen = len;
+   this->displayDirty = 0;
+   this->displayGeneration = Process_displayGeneration;
+}
+
+void Process_freeDisplayLine(Process* this) {
+   free(this->displayLine);
+   this->displayLine = NULL;
+   this->displayLineLen = 0;
+   this->displayLineSize = 0;
+   this->displayGeneration = 0;
+}
+
 void Process_display(Object* cast, RichString* out) {
-   const Process *this = (const Process *)cast;
+   Process *this = (Process *)cast;
+   this->displayed = true;
+   if (!this->displayDirty && this->displayGeneration == Process_displayGeneration) {
+      RichString_setChars(out, this->displayLine, this->displayLineLen);
+      return;
+   }
    const unsigned int *fields = this->settings->fields;
    RichString_prune(out);
    for (int i = 0; fields[i]; i++) {
@@ -593,10 +699,12 @@ void Process_display(Object* cast, RichString* out) {
       RichString_setAttr(out, CRT_colors[HTOP_PROCESS_CREATED_COLOR]);
    }
    assert(out->chlen > 0);
+   Process_storeDisplayLine(this, out);
 }
 
 void Process_done(Process* this) {
    assert (this != NULL);
+   free(this->displayLine);
    free(this->name);
    free(this->comm);
 }
@@ -611,6 +719,117 @@ static bool base_Process_isSelf(const Process *this) {
 	return this->pid == mypid;
 }
 
+void base_Process_addSubtree(Process *this, const Process *child) {
+	if(!child) {
+		this->subtree_percent_cpu = this->percent_cpu;
+		this->subtree_m_resident = this->m_resident;
+		return;
+	}
+	this->subtree_percent_cpu += child->subtree_percent_cpu;
+	this->subtree_m_resident += child->subtree_m_resident;
+}
+
+uint64_t Process_floatSortKey(double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof bits);
+	return bits & (UINT64_C(1) << 63) ? ~bits : bits | (UINT64_C(1) << 63);
+}
+
+// Key of the first 8 bytes, so longer strings need PROCESS_SORT_KEY_PARTIAL
+uint64_t Process_stringSortKey(const struct Settings_ *settings, const char *s) {
+	bool fold = settings->sort_strcmp == strcasecmp;
+	uint64_t key = 0;
+	int i;
+	for(i = 0; i < 8 && s[i]; i++) {
+		key = key << 8 | (unsigned char)(fold ? tolower((unsigned char)s[i]) : s[i]);
+	}
+	for(; i < 8; i++) key <<= 8;
+	return key;
+}
+
+ProcessSortKeyKind base_Process_getSortKey(const Process *this, ProcessField field, uint64_t *key) {
+	switch(field) {
+		case HTOP_PERCENT_CPU_FIELD:
+			*key = ~Process_floatSortKey(this->percent_cpu);
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_PERCENT_MEM_FIELD:
+		case HTOP_M_RESIDENT_FIELD:
+			*key = ~Process_signedSortKey(this->m_resident);
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_NAME_FIELD:
+			*key = Process_stringSortKey(this->settings, this->name);
+			return PROCESS_SORT_KEY_PARTIAL;
+		case HTOP_COMM_FIELD:
+			*key = Process_stringSortKey(this->settings, this->comm);
+			return PROCESS_SORT_KEY_PARTIAL;
+		case HTOP_MAJFLT_FIELD:
+			*key = ~(uint64_t)this->majflt;
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_MINFLT_FIELD:
+			*key = ~(uint64_t)this->minflt;
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_M_SIZE_FIELD:
+			*key = ~Process_signedSortKey(this->m_size);
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_NICE_FIELD:
+			*key = Process_signedSortKey(this->nice);
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_NLWP_FIELD:
+			*key = Process_signedSortKey(this->nlwp);
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_PGRP_FIELD:
+			*key = this->pgrp;
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_PPID_FIELD:
+			*key = Process_signedSortKey(this->ppid);
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_PRIORITY_FIELD:
+			*key = Process_signedSortKey(this->priority);
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_PROCESSOR_FIELD:
+			*key = Process_signedSortKey(this->processor);
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_SESSION_FIELD:
+			*key = this->session;
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_STARTTIME_FIELD:
+			*key = Process_signedSortKey(this->starttime_ctime);
+			return PROCESS_SORT_KEY_PARTIAL;
+		case HTOP_STATE_FIELD:
+			*key = Process_sortState(this->state);
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_REAL_UID_FIELD:
+			*key = this->ruid;
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_EFFECTIVE_UID_FIELD:
+			*key = this->euid;
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_TIME_FIELD:
+			*key = ~(uint64_t)this->time;
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_TGID_FIELD:
+			*key = Process_signedSortKey(this->tgid);
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_TPGID_FIELD:
+			*key = Process_signedSortKey(this->tpgid);
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_TTY_FIELD:
+			*key = this->tty_nr;
+			return PROCESS_SORT_KEY_EXACT;
+		case HTOP_REAL_USER_FIELD:
+			*key = Process_stringSortKey(this->settings, this->real_user ? this->real_user : "");
+			return PROCESS_SORT_KEY_PARTIAL;
+		case HTOP_EFFECTIVE_USER_FIELD:
+			*key = Process_stringSortKey(this->settings, this->effective_user ? this->effective_user : "");
+			return PROCESS_SORT_KEY_PARTIAL;
+		case HTOP_PID_FIELD:
+			*key = Process_signedSortKey(this->pid);
+			return PROCESS_SORT_KEY_EXACT;
+		default:
+			return PROCESS_SORT_KEY_NONE;
+	}
+}
+
 static void Process_inherit(ObjectClass *super_class) {
 	if(!super_class->display) super_class->display = Process_display;
 	if(!super_class->compare) super_class->compare = Process_compare;
@@ -618,6 +837,7 @@ static void Process_inherit(ObjectClass *super_class) {
 	if(!class->writeField) class->writeField = Process_writeField;
 	if(!class->sendSignal) class->sendSignal = base_Process_sendSignal;
 	if(!class->isSelf) class->isSelf = base_Process_isSelf;
+	if(!class->addSubtree) class->addSubtree = base_Process_addSubtree;
 }
 
 ProcessClass Process_class = {
@@ -629,7 +849,9 @@ ProcessClass Process_class = {
    },
    .writeField = Process_writeField,
    .sendSignal = base_Process_sendSignal,
-   .isSelf = base_Process_isSelf
+   .isSelf = base_Process_isSelf,
+   .addSubtree = base_Process_addSubtree,
+   .getSortKey = base_Process_getSortKey
 };
 
 void Process_init(Process* this, struct Settings_* settings) {
@@ -641,11 +863,18 @@ void Process_init(Process* this, struct Settings_* settings) {
    this->updated = false;
    this->argv0_length = -1;
    this->processor = -1;
+   this->filterGeneration = 0;
+   this->displayLine = NULL;
+   this->displayLineLen = 0;
+   this->displayLineSize = 0;
+   this->displayDirty = 0;
+   this->displayGeneration = 0;
    if (Process_getuid == -1) Process_getuid = getuid();
 }
 
 void Process_toggleTag(Process* this) {
    this->tag = !this->tag;
+   this->displayDirty |= PROCESS_DIRTY_TAG;
 }
 
 bool Process_setPriority(Process* this, int priority) {
@@ -25,11 +25,22 @@ in the source distribution for its full text.
 #include "FieldData.h"
 #include <sys/types.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #define uintcmp(n1,n2) ((n1)>(n2)?1:((n1)<(n2)?-1:0))
 
+// Maps signed values to sort keys in the same order
+#define Process_signedSortKey(value_) ((uint64_t)(int64_t)(value_) ^ (UINT64_C(1) << 63))
+
 #define PROCESS_FLAG_IO 0x0001
 
+// Reasons for Process_display to format the line again
+#define PROCESS_DIRTY_VALUES 0x0001
+#define PROCESS_DIRTY_TREE 0x0002
+#define PROCESS_DIRTY_TAG 0x0004
+// Columns with values summed over the process subtree
+#define PROCESS_FLAG_SUBTREE 0x0002
+
 typedef enum {
    HTOP_NULL_PROCESSFIELD = 0,
    HTOP_PID_FIELD = 1,
@@ -77,8 +88,33 @@ typedef struct Process_ {
    bool showChildren;
    bool show;
    bool seen_in_tree_loop;
+   // Set when drawn on screen, cleared by the platform scan
+   bool displayed;
+   // Whether the command and PID pass the ProcessList filters, valid while
+   // filterGeneration is the list's; platforms reset it to 0 when the
+   // command changes
+   bool filterMatch;
+   unsigned int filterGeneration;
+   // Line last formatted by Process_display, reused by later redraws while
+   // no PROCESS_DIRTY_* bit is set and displayGeneration is still the
+   // current one; see Process_invalidateDisplay
+   CharType* displayLine;
+   int displayLineLen;
+   int displayLineSize;
+   unsigned int displayDirty;
+   unsigned int displayGeneration;
    int indent;
 
+   // Process tree kept by ProcessList across scans; siblings are linked in
+   // descending PID order
+   struct Process_* treeParent;
+   struct Process_* treeFirstChild;
+   struct Process_* treeNextSibling;
+   struct Process_* treePrevSibling;
+   pid_t treeParentPid;
+   bool treeLinked;
+   unsigned int treeGeneration;
+
    int state;
    pid_t pid;
    pid_t ppid;
@@ -104,6 +140,11 @@ typedef struct Process_ {
    float percent_cpu;
    float percent_mem;
 
+   // Totals for the process and its descendants in the tree, updated by
+   // ProcessList_scan when a PROCESS_FLAG_SUBTREE column is used
+   float subtree_percent_cpu;
+   long int subtree_m_resident;
+
    long int priority;
    long int nice;
    long int nlwp;
@@ -130,12 +171,31 @@ typedef Process*(*Process_New)(struct Settings_*);
 typedef void (*ProcessWriteFieldFunction)(const Process *, RichString *, ProcessField);
 typedef bool (*ProcessSendSignalFunction)(const Process *, int);
 typedef bool (*ProcessGetBooleanFunction)(const Process *);
+typedef void (*ProcessAddSubtreeFunction)(Process *, const Process *);
+
+typedef enum {
+   PROCESS_SORT_KEY_NONE,
+   PROCESS_SORT_KEY_EXACT,
+   // Processes with equal keys still have to be ordered with the compare
+   // function
+   PROCESS_SORT_KEY_PARTIAL
+} ProcessSortKeyKind;
+
+typedef ProcessSortKeyKind (*ProcessGetSortKeyFunction)(const Process *, ProcessField, uint64_t *);
 
 typedef struct ProcessClass_ {
    ObjectClass super;
    ProcessWriteFieldFunction writeField;
    ProcessSendSignalFunction sendSignal;
    ProcessGetBooleanFunction isSelf;
+   // Resets the subtree totals to the process's own values when the child
+   // is NULL, otherwise adds the totals of the child
+   ProcessAddSubtreeFunction addSubtree;
+   // Gets a key ordering processes as the compare function does when
+   // sorting in ascending direction. Not inherited, as subclasses may
+   // compare the generic fields differently; base_Process_getSortKey
+   // covers those of Process_compare
+   ProcessGetSortKeyFunction getSortKey;
 } ProcessClass;
 
 #define As_Process(this_)              ((ProcessClass*)((this_)->super.klass))
@@ -148,6 +208,7 @@ typedef struct ProcessClass_ {
 #define Process_isChildOf(process_, pid_) ((process_)->tgid == (pid_) || ((process_)->tgid == (process_)->pid && (process_)->ppid == (pid_)))
 #endif
 #define Process_isSelf(this_) (As_Process(this_)->isSelf(this_))
+#define Process_addSubtree(this_, child_) (As_Process(this_)->addSubtree((this_), (child_)))
 #define Process_sortState(state) ((state) == 'I' ? 0x100 : (state))
 
 
@@ -161,6 +222,12 @@ typedef struct ProcessClass_ {
 
 extern char Process_pidFormat[20];
 
+/*
+ * Makes every process format its line again on the next display, after a
+ * change of the settings, colors or column widths.
+ */
+void Process_invalidateDisplay();
+
 void Process_setupColumnWidths();
 
 void Process_humanNumber(RichString* str, unsigned long number, bool coloring);
@@ -169,12 +236,26 @@ void Process_colorNumber(RichString* str, unsigned long long number, bool colori
 
 void Process_outputRate(RichString* str, char* buffer, int n, double rate, int coloring);
 
+// Returns the color to print the value in
+int Process_printPercentCpu(float percent_cpu, char* buffer, int n);
+
 void Process_writeField(const Process *this, RichString* str, ProcessField field);
 
+void Process_freeDisplayLine(Process* this);
+
 void Process_display(Object* cast, RichString* out);
 
 void Process_done(Process* this);
 
+void base_Process_addSubtree(Process *this, const Process *child);
+
+uint64_t Process_floatSortKey(double value);
+
+// Key of the first 8 bytes, so longer strings need PROCESS_SORT_KEY_PARTIAL
+uint64_t Process_stringSortKey(const struct Settings_ *settings, const char *s);
+
+ProcessSortKeyKind base_Process_getSortKey(const Process *this, ProcessField field, uint64_t *key);
+
 extern ProcessClass Process_class;
 
 void Process_init(Process* this, struct Settings_* settings);
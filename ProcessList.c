@@ -13,6 +13,11 @@ in the source distribution for its full text.
 #include "KStat.h"
 #include <stdlib.h>
 #include <string.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
 
 /*{
 #include "Vector.h"
@@ -35,6 +40,12 @@ in the source distribution for its full text.
 #define MAX_READ 2048
 #endif
 
+// Below this many processes, sorting with the compare function is cheaper
+// than extracting the sort keys
+#define PROCESSLIST_KEY_SORT_MIN 256
+
+typedef struct ProcessListScanner_ ProcessListScanner;
+
 typedef struct ProcessList_ {
    Settings* settings;
 
@@ -48,6 +59,12 @@ typedef struct ProcessList_ {
    int following;
    uid_t userId;
    const char* incFilter;
+   // Bumped when the filters change, see Process.filterMatch
+   unsigned int filterGeneration;
+   // Copy of the incFilter last matched, and whether the current one only
+   // narrows down its matches
+   char* lastFilter;
+   bool filterRefines;
 
    #ifdef HAVE_LIBHWLOC
    hwloc_topology_t topology;
@@ -55,6 +72,26 @@ typedef struct ProcessList_ {
    #endif
 
    bool should_update_names;
+   // Processes without a parent in the list, linked like siblings
+   Process* treeRoots;
+   unsigned int treeGeneration;
+   // Keys of the processes and room to sort them, for ProcessList_sort
+   VectorSortKey* sortKeys;
+   int sortKeysSize;
+   // Leading processes in sort order; when the flat view is sorted only as
+   // far as the rows in sight, the others just follow them
+   int sortedCount;
+   // Set while the whole list has to be in order, such as while searching
+   bool sortAll;
+   // Set by platforms that reset the created, updated and show flags of
+   // processes by themselves while scanning
+   bool scan_marks_processes;
+   // Thread scanning in the background, started by the first ProcessList_startScan
+   ProcessListScanner* scanner;
+   // Set from ProcessList_startScan until ProcessList_finishScan, and while
+   // the scan runs on the scanner thread
+   bool scanPending;
+   bool scanBackground;
 
    int totalTasks;
    int thread_count;
@@ -82,8 +119,39 @@ void ProcessList_delete(ProcessList* pl);
 void ProcessList_goThroughEntries(ProcessList *, bool);
 
 #define ProcessList_shouldUpdateProcessNames(THIS) ((THIS)->should_update_names || (THIS)->settings->updateProcessNames)
+
+// Whether a scan runs in the background, see ProcessList_startScan
+#define ProcessList_isScanning(THIS) ((THIS)->scanBackground)
 }*/
 
+#ifdef HAVE_PTHREAD
+
+struct ProcessListScanner_ {
+   // The scanner thread updates the same processes the UI shows; there is no
+   // snapshot of them. The list is handed over instead: the UI thread holds
+   // it except while waiting for keys, and the scanning threads only use it
+   // while it isn't held, giving way to the UI at ProcessList_yieldScan.
+   // A key is handled once the scanner reaches the next of these, which
+   // every phase of the scan calls between processes or chunks of them, so
+   // a single slow read in /proc or from the system still delays it.
+   pthread_t thread;
+   pthread_mutex_t lock;
+   pthread_cond_t changed;
+   bool requested;
+   bool sampled;
+   bool quit;
+   // Whether the current scan runs on the scanner thread
+   bool background;
+   // Scanning threads using the list
+   int running;
+   bool uiHolding;
+   bool uiWaiting;
+   // Written to once the processes are read, see ProcessList_scanFd
+   int wakeFds[2];
+};
+
+#endif
+
 ProcessList* ProcessList_init(ProcessList* this, ObjectClass* klass, UsersTable* usersTable, const Hashtable *pidWhiteList, uid_t userId) {
    this->processes = Vector_new(klass, true, DEFAULT_SIZE);
    this->processTable = Hashtable_new(140, false);
@@ -94,6 +162,16 @@ ProcessList* ProcessList_init(ProcessList* this, ObjectClass* klass, UsersTable*
    this->processes2 = Vector_new(klass, true, DEFAULT_SIZE);
    // set later by platform-specific code
    this->cpuCount = 0;
+   this->sortKeys = NULL;
+   this->sortKeysSize = 0;
+   this->sortedCount = 0;
+   this->sortAll = false;
+   this->filterGeneration = 1;
+   this->lastFilter = NULL;
+   this->filterRefines = false;
+   this->scanner = NULL;
+   this->scanPending = false;
+   this->scanBackground = false;
 
 #ifdef HAVE_LIBHWLOC
    this->topologyOk = false;
@@ -112,6 +190,23 @@ ProcessList* ProcessList_init(ProcessList* this, ObjectClass* klass, UsersTable*
 }
 
 void ProcessList_done(ProcessList* this) {
+#ifdef HAVE_PTHREAD
+   ProcessListScanner* scanner = this->scanner;
+   if (scanner) {
+      // A scan still running is let through to the end
+      pthread_mutex_lock(&scanner->lock);
+      scanner->quit = true;
+      scanner->uiHolding = false;
+      pthread_cond_broadcast(&scanner->changed);
+      pthread_mutex_unlock(&scanner->lock);
+      pthread_join(scanner->thread, NULL);
+      close(scanner->wakeFds[0]);
+      close(scanner->wakeFds[1]);
+      pthread_cond_destroy(&scanner->changed);
+      pthread_mutex_destroy(&scanner->lock);
+      free(scanner);
+   }
+#endif
 #ifdef HAVE_LIBHWLOC
    if (this->topologyOk) {
       hwloc_topology_destroy(this->topology);
@@ -120,6 +215,8 @@ void ProcessList_done(ProcessList* this) {
    Hashtable_delete(this->processTable);
    Vector_delete(this->processes);
    Vector_delete(this->processes2);
+   free(this->sortKeys);
+   free(this->lastFilter);
 }
 
 void ProcessList_setPanel(ProcessList* this, Panel* panel) {
@@ -138,6 +235,58 @@ void ProcessList_printHeader(ProcessList* this, RichString* header) {
    }
 }
 
+static void ProcessList_insertTreeNode(Process** first, Process* p) {
+   // Keeps siblings in descending PID order; new processes usually go first
+   Process* prev = NULL;
+   Process* next = *first;
+   while (next && next->pid > p->pid) {
+      prev = next;
+      next = next->treeNextSibling;
+   }
+   p->treePrevSibling = prev;
+   p->treeNextSibling = next;
+   if (prev) prev->treeNextSibling = p;
+   else *first = p;
+   if (next) next->treePrevSibling = p;
+}
+
+static void ProcessList_unlinkTreeNode(ProcessList* this, Process* p) {
+   Process** first = p->treeParent ? &p->treeParent->treeFirstChild : &this->treeRoots;
+   if (p->treePrevSibling) p->treePrevSibling->treeNextSibling = p->treeNextSibling;
+   else *first = p->treeNextSibling;
+   if (p->treeNextSibling) p->treeNextSibling->treePrevSibling = p->treePrevSibling;
+   p->treeParent = NULL;
+   p->treePrevSibling = NULL;
+   p->treeNextSibling = NULL;
+}
+
+static void ProcessList_linkTreeNode(ProcessList* this, Process* p) {
+   // Links a process under its parent in the process tree, or among the roots
+   // if its parent is not in the list.
+   if (p->treeLinked) ProcessList_unlinkTreeNode(this, p);
+   pid_t ppid = Process_getParentPid(p);
+   Process* parent = ppid == p->pid ? NULL : Hashtable_get(this->processTable, ppid);
+   p->treeParent = parent;
+   p->treeParentPid = ppid;
+   p->treeLinked = true;
+   ProcessList_insertTreeNode(parent ? &parent->treeFirstChild : &this->treeRoots, p);
+}
+
+static void ProcessList_removeTreeNode(ProcessList* this, Process* p) {
+   if (!p->treeLinked) return;
+   ProcessList_unlinkTreeNode(this, p);
+   // The children become roots, until a process with their parent PID shows up
+   Process* child = p->treeFirstChild;
+   while (child) {
+      Process* next = child->treeNextSibling;
+      child->treeParent = NULL;
+      ProcessList_insertTreeNode(&this->treeRoots, child);
+      child = next;
+   }
+   p->treeFirstChild = NULL;
+   p->treeLinked = false;
+}
+
 void ProcessList_add(ProcessList* this, Process* p) {
    assert(Vector_indexOf(this->processes, p, Process_pidCompare) == -1);
    assert(Hashtable_get(this->processTable, p->pid) == NULL);
@@ -148,17 +297,68 @@ void ProcessList_add(ProcessList* this, Process* p) {
    assert(Hashtable_count(this->processTable) == Vector_count(this->processes));
 }
 
-void ProcessList_remove(ProcessList* this, Process* p) {
-   assert(Vector_indexOf(this->processes, p, Process_pidCompare) != -1);
-   assert(Hashtable_get(this->processTable, p->pid) != NULL);
-   Process* pp = Hashtable_remove(this->processTable, p->pid);
-   assert(pp == p); (void)pp;
-   unsigned int pid = p->pid;
-   int idx = Vector_indexOf(this->processes, p, Process_pidCompare);
-   assert(idx != -1);
-   if (idx >= 0) Vector_remove(this->processes, idx);
-   assert(Hashtable_get(this->processTable, pid) == NULL); (void)pid;
-   assert(Hashtable_count(this->processTable) == Vector_count(this->processes));
+typedef struct ProcessListFilter_ {
+   ProcessList* pl;
+   int position;
+   // Processes removed from among the ones in sort order
+   int sortedRemoved;
+} ProcessListFilter;
+
+static bool ProcessList_keepUpdated(Object* cast, void* data) {
+   Process* p = (Process*) cast;
+   ProcessListFilter* filter = data;
+   ProcessList* this = filter->pl;
+   bool sorted = filter->position++ < this->sortedCount;
+   if (p->updated) {
+      // A line not drawn again since the previous scan is of a process off
+      // screen, better freed than kept stale
+      if (p->displayDirty & PROCESS_DIRTY_VALUES) Process_freeDisplayLine(p);
+      p->displayDirty |= PROCESS_DIRTY_VALUES;
+      // Link new and reparented processes into the tree
+      if (!p->treeLinked || p->treeParentPid != Process_getParentPid(p))
+         ProcessList_linkTreeNode(this, p);
+      return true;
+   }
+   ProcessList_removeTreeNode(this, p);
+   Hashtable_remove(this->processTable, p->pid);
+   if (sorted) filter->sortedRemoved++;
+   return false;
+}
+
+static void ProcessList_adoptRoots(ProcessList* this) {
+   // Moves under their parent the roots whose parent appeared after them
+   Process* root = this->treeRoots;
+   while (root) {
+      Process* next = root->treeNextSibling;
+      if (root->treeParentPid != root->pid && Hashtable_get(this->processTable, root->treeParentPid))
+         ProcessList_linkTreeNode(this, root);
+      root = next;
+   }
+}
+
+static void ProcessList_aggregateTree(ProcessList* this) {
+   // Sums the subtree columns up the process tree, in a single post-order walk
+   // of each tree. Threads are not added to their process, whose own values
+   // already cover them. Processes in a loop only get their own values.
+   int size = Vector_size(this->processes);
+   for (int i = 0; i < size; i++) {
+      Process* p = (Process*) Vector_get(this->processes, i);
+      Process_addSubtree(p, NULL);
+   }
+   for (Process* root = this->treeRoots; root; root = root->treeNextSibling) {
+      Process* p = root;
+      while (true) {
+         while (p->treeFirstChild) p = p->treeFirstChild;
+         // Everything below p is summed up; climb until a sibling is left
+         while (p != root && !p->treeNextSibling) {
+            if (p->pid == p->tgid) Process_addSubtree(p->treeParent, p);
+            p = p->treeParent;
+         }
+         if (p == root) break;
+         if (p->pid == p->tgid) Process_addSubtree(p->treeParent, p);
+         p = p->treeNextSibling;
+      }
+   }
 }
 
 Process* ProcessList_get(ProcessList* this, int idx) {
@@ -169,138 +369,312 @@ int ProcessList_size(ProcessList* this) {
    return (Vector_size(this->processes));
 }
 
-static void ProcessList_buildTree(ProcessList* this, pid_t pid, int level, int indent, int direction, bool show) {
-   Vector* children = Vector_new(Class(Process), false, DEFAULT_SIZE);
+typedef struct ProcessTreeFrame_ {
+   int level;
+   int indent;
+   bool show;
+   Process* child;
+   // When sorting siblings, the children are siblings[first] up to
+   // siblings[end], from siblings[next] on still to be placed
+   int first;
+   int next;
+   int end;
+} ProcessTreeFrame;
+
+typedef struct ProcessTreeBuilder_ {
+   ProcessTreeFrame* frames;
+   // Processes in display order; top-level processes, and children when
+   // sorting ascending, are appended from the start, while children when
+   // sorting descending are prepended, filling from the end
+   Process** order;
+   int appended;
+   int prepended;
+   int size;
+   // Hidden processes met among children, which start trees of their own
+   Process** hidden;
+   int hiddenCount;
+   unsigned int generation;
+   // Set to sort siblings, whose lists are stacked up in siblings as the
+   // walk goes down
+   Object_Compare compare;
+   Process** siblings;
+   int siblingCount;
+} ProcessTreeBuilder;
+
+#define ProcessTreeBuilder_isPlaced(this_, p_) ((p_)->treeGeneration == (this_)->generation)
 
-   for (int i = Vector_size(this->processes) - 1; i >= 0; i--) {
-      Process* process = (Process*) (Vector_get(this->processes, i));
-      if (process->show && Process_isChildOf(process, pid)) {
-         process = (Process*) (Vector_take(this->processes, i));
-         Vector_add(children, process);
+static void ProcessTreeBuilder_emit(ProcessTreeBuilder* this, Process* process, bool append) {
+   process->treeGeneration = this->generation;
+   if (append) this->order[this->appended++] = process;
+   else this->order[this->size - ++this->prepended] = process;
+}
+
+static inline void ProcessTreeBuilder_setIndent(Process* process, int indent) {
+   if (process->indent == indent) return;
+   process->indent = indent;
+   process->displayDirty |= PROCESS_DIRTY_TREE;
+}
+
+static Process* ProcessTreeBuilder_nextChild(ProcessTreeBuilder* this, Process* child) {
+   // Skips the children that are hidden or already placed elsewhere
+   while (child && (ProcessTreeBuilder_isPlaced(this, child) || !child->show)) {
+      if (!ProcessTreeBuilder_isPlaced(this, child)) this->hidden[this->hiddenCount++] = child;
+      child = child->treeNextSibling;
+   }
+   return child;
+}
+
+static void ProcessTreeBuilder_enter(ProcessTreeBuilder* this, ProcessTreeFrame* frame, Process* process) {
+   // Starts the walk of the children of a process in a new frame
+   Process* child = ProcessTreeBuilder_nextChild(this, process->treeFirstChild);
+   if (!this->compare) {
+      frame->child = child;
+      return;
+   }
+   frame->first = frame->next = this->siblingCount;
+   for (; child; child = ProcessTreeBuilder_nextChild(this, child->treeNextSibling)) {
+      this->siblings[this->siblingCount++] = child;
+   }
+   frame->end = this->siblingCount;
+   Vector_sortArray((Object**)this->siblings + frame->next, frame->end - frame->next, this->compare);
+   frame->child = frame->next < frame->end ? this->siblings[frame->next++] : NULL;
+}
+
+static Process* ProcessTreeBuilder_advance(ProcessTreeBuilder* this, ProcessTreeFrame* frame) {
+   // Moves on to the next child in a frame, returning it
+   if (!this->compare) {
+      frame->child = ProcessTreeBuilder_nextChild(this, frame->child->treeNextSibling);
+   } else {
+      frame->child = frame->next < frame->end ? this->siblings[frame->next++] : NULL;
+   }
+   return frame->child;
+}
+
+static void ProcessTreeBuilder_addChildren(ProcessTreeBuilder* this, Process* process, int level, int direction, bool show) {
+   // Places the descendants of a process, which must have been placed
+   // already, with a depth-first walk.
+   ProcessTreeFrame* frames = this->frames;
+   int depth = 0;
+   frames[0].level = level;
+   frames[0].indent = 0;
+   frames[0].show = show;
+   ProcessTreeBuilder_enter(this, frames, process);
+   // Sorted siblings are placed in order, whatever the direction
+   bool append = this->compare || direction == 1;
+   while (depth >= 0) {
+      ProcessTreeFrame* frame = frames + depth;
+      Process* child = frame->child;
+      if (!child) {
+         // The list walked is the last one stacked
+         if (this->compare) this->siblingCount = frame->first;
+         depth--;
+         continue;
       }
+      Process* next = ProcessTreeBuilder_advance(this, frame);
+      child->seen_in_tree_loop = false;
+      if (!frame->show) child->show = false;
+      ProcessTreeBuilder_emit(this, child, append);
+      int nextIndent = frame->level < 0 ? 0 : (frame->indent | (1 << frame->level));
+      ProcessTreeBuilder_setIndent(child, next ? nextIndent : -nextIndent);
+      ProcessTreeFrame* childFrame = frames + ++depth;
+      childFrame->level = frame->level + 1;
+      childFrame->indent = next ? nextIndent : frame->indent;
+      childFrame->show = frame->show && child->showChildren;
+      ProcessTreeBuilder_enter(this, childFrame, child);
    }
-   int size = Vector_size(children);
-   for (int i = 0; i < size; i++) {
-      Process* process = (Process *)Vector_get(children, i);
+}
+
+static void ProcessTreeBuilder_addTree(ProcessTreeBuilder* this, Process* process, int level, int direction, bool show) {
+   ProcessTreeBuilder_setIndent(process, 0);
+   ProcessTreeBuilder_emit(this, process, true);
+   ProcessTreeBuilder_addChildren(this, process, level, direction, show);
+}
+
+static void ProcessList_sortTree(ProcessList* this) {
+   // Lays out the processes in tree order, following the process tree kept up
+   // to date by ProcessList_scan. Trees start at each process whose parent is
+   // not in the list, in PID order, or in the order of the sort key as are
+   // siblings when tree_sort_siblings is set.
+   int direction = this->settings->direction;
+   int size = Vector_size(this->processes);
+   if (size == 0) return;
+
+   int rootCount = 0;
+   Process* root;
+   for (root = this->treeRoots; root; root = root->treeNextSibling) {
+      rootCount++;
+   }
+
+   ProcessTreeBuilder builder;
+   builder.frames = xMalloc((size + 1) * sizeof(ProcessTreeFrame));
+   builder.order = xMalloc(size * sizeof(Process*));
+   builder.hidden = xMalloc(size * sizeof(Process*));
+   builder.appended = 0;
+   builder.prepended = 0;
+   builder.hiddenCount = 0;
+   builder.size = size;
+   builder.generation = ++this->treeGeneration;
+   builder.compare = this->settings->tree_sort_siblings ? this->processes->type->compare : NULL;
+   builder.siblings = builder.compare ? xMalloc(size * sizeof(Process*)) : NULL;
+   builder.siblingCount = 0;
+
+   // Roots are linked in descending PID order
+   Process** roots = xMalloc(rootCount * sizeof(Process*));
+   int i = rootCount;
+   for (root = this->treeRoots; root; root = root->treeNextSibling) {
+      roots[--i] = root;
+   }
+   if (builder.compare) Vector_sortArray((Object**)roots, rootCount, builder.compare);
+   for (i = 0; i < rootCount; i++) {
+      Process* process = roots[i];
       process->seen_in_tree_loop = false;
-      if (!show) process->show = false;
-      int s = this->processes2->items;
-      if (direction == 1) Vector_add(this->processes2, process);
-      else Vector_insert(this->processes2, 0, process);
-      assert(this->processes2->items == s+1); (void)s;
-      int nextIndent = level < 0 ? 0 : (indent | (1 << level));
-      ProcessList_buildTree(this, process->pid, level+1, (i < size - 1) ? nextIndent : indent, direction, show && process->showChildren);
-      process->indent = (i < size - 1) ? nextIndent : -nextIndent;
-   }
-   Vector_delete(children);
-}
-
-static Process *ProcessList_findParent(const ProcessList *this, const Process *proc, int *index) {
-   // Bisect the process vector to find parent
-   // If PID corresponds with PPID (e.g. "kernel_task" (PID=0, PPID=0)
-   // on Mac OS X) cancel bisecting and regard this process as root.
-   pid_t ppid = Process_getParentPid(proc);
-   if(ppid == proc->pid) return NULL;
-   int l = 0, r = Vector_size(this->processes);
-   while (l < r) {
-      int c = (l + r) / 2;
-      Process *p = (Process *)Vector_get(this->processes, c);
-      if (ppid == p->pid) {
-         if(index) *index = c;
-         return p;
+      ProcessTreeBuilder_addTree(&builder, process, process->show ? 0 : -1, direction, process->showChildren);
+   }
+   free(roots);
+
+   // Hidden processes that are not roots start trees of their own, with
+   // everything below them hidden as well
+   for (i = 0; i < builder.hiddenCount; i++) {
+      Process* process = builder.hidden[i];
+      if (ProcessTreeBuilder_isPlaced(&builder, process)) continue;
+      process->seen_in_tree_loop = false;
+      ProcessTreeBuilder_addTree(&builder, process, 0, direction, false);
+   }
+
+   /* Under some ptrace(2) implementations, a process
+    * ptrace(2)-attaching a parent process in its
+    * process tree will causing the traced process to be
+    * re-parented to the tracing process; this will
+    * creating a loop in the process tree. In this case
+    * build separated tree(s) for loop(s) left here.
+    */
+   if (builder.appended + builder.prepended < size) {
+      for (i = 0; i < size; i++) {
+         ((Process*) Vector_get(this->processes, i))->seen_in_tree_loop = false;
       }
-      if (ppid < p->pid) r = c;
-      else l = c + 1;
    }
-   return NULL;
+   while (builder.appended + builder.prepended < size) {
+      /* This remaining process, the one with the
+       * highest PID, could either be a node at the
+       * loop it self, or a descendant node
+       * indirectly attached to the loop.
+       */
+      Process* proc = NULL;
+      for (i = 0; i < size; i++) {
+         Process* p = (Process*) Vector_get(this->processes, i);
+         if (!ProcessTreeBuilder_isPlaced(&builder, p) && (!proc || p->pid > proc->pid)) proc = p;
+      }
+      if (!proc->show) {
+         ProcessTreeBuilder_addTree(&builder, proc, 0, direction, false);
+         continue;
+      }
+      do {
+         /* Make sure we break at the
+          * loop itself, not a
+          * descendant of it. */
+         proc->seen_in_tree_loop = true;
+         assert(proc->treeParent != NULL);
+         if (!proc->treeParent) break;
+         proc = proc->treeParent;
+      } while(!proc->seen_in_tree_loop);
+      ProcessTreeBuilder_addTree(&builder, proc, 0, direction, proc->show);
+   }
+   assert(builder.appended + builder.prepended == size);
+
+   // Empty the old listing from its end, which doesn't shift items
+   assert(Vector_size(this->processes2) == 0);
+   for (i = size - builder.prepended; i < size; i++) {
+      Vector_add(this->processes2, builder.order[i]);
+   }
+   for (i = 0; i < builder.appended; i++) {
+      Vector_add(this->processes2, builder.order[i]);
+   }
+   while (size > 0) {
+      Vector_take(this->processes, --size);
+   }
+   free(builder.frames);
+   free(builder.order);
+   free(builder.hidden);
+   free(builder.siblings);
+   // Swap listings around
+   Vector* t = this->processes;
+   this->processes = this->processes2;
+   this->processes2 = t;
+}
+
+static bool ProcessList_sortByKey(ProcessList* this, int count) {
+   // Sorts by keys extracted from the processes up front, rather than
+   // comparing them through the class and settings over and over. Returns
+   // false if the platform has no keys for the sort field.
+   int size = Vector_size(this->processes);
+   if (size < PROCESSLIST_KEY_SORT_MIN) return false;
+   const Process* first = (const Process*) Vector_get(this->processes, 0);
+   ProcessGetSortKeyFunction getSortKey = As_Process(first)->getSortKey;
+   if (!getSortKey) return false;
+
+   if (this->sortKeysSize < size * 2) {
+      this->sortKeysSize = size * 4;
+      free(this->sortKeys);
+      this->sortKeys = xMalloc(this->sortKeysSize * sizeof(VectorSortKey));
+   }
+   VectorSortKey* keys = this->sortKeys;
+   const Settings* settings = this->settings;
+   ProcessField field = settings->sortKey;
+   // Descending keys are complemented
+   uint64_t flip = settings->direction == 1 ? 0 : ~(uint64_t)0;
+   bool partial = false;
+   for (int i = 0; i < size; i++) {
+      Process* p = (Process*) Vector_get(this->processes, i);
+      ProcessSortKeyKind kind = getSortKey(p, field, &keys[i].key);
+      if (kind == PROCESS_SORT_KEY_NONE) return false;
+      if (kind == PROCESS_SORT_KEY_PARTIAL) partial = true;
+      keys[i].key ^= flip;
+      keys[i].object = (Object*) p;
+   }
+   this->sortedCount = Vector_sortKeysPartially(this->processes, keys, keys + size, count, partial ? this->processes->type->compare : NULL);
+   return true;
+}
+
+static int ProcessList_sortWindow(const ProcessList* this) {
+   // Returns how many processes to sort for the rows in sight, with a page to
+   // spare, or all of them below the partial_sort_threshold setting.
+   int size = Vector_size(this->processes);
+   int threshold = this->settings->partial_sort_threshold;
+   if (!threshold || size < threshold || this->sortAll || this->following != -1 || !this->panel)
+      return size;
+   const Panel* panel = this->panel;
+   int top = panel->selected > panel->scrollV ? panel->selected : panel->scrollV;
+   return top + 2 * panel->h;
+}
+
+static void ProcessList_finishSort(ProcessList* this) {
+   // Sorts the processes left after a partial sort
+   int size = Vector_size(this->processes);
+   if (this->sortedCount >= size || this->settings->treeView) return;
+   Vector_sortArray(this->processes->array + this->sortedCount, size - this->sortedCount, this->processes->type->compare);
+   this->sortedCount = size;
 }
 
 void ProcessList_sort(ProcessList* this) {
    if (!this->settings->treeView) {
-      Vector_insertionSort(this->processes);
-   } else {
-      // Save settings
-      int direction = this->settings->direction;
-      int sortKey = this->settings->sortKey;
-      // Sort by PID
-      this->settings->sortKey = HTOP_PID_FIELD;
-      this->settings->direction = 1;
-      Vector_quickSort(this->processes);
-      // Restore settings
-      this->settings->sortKey = sortKey;
-      this->settings->direction = direction;
-      int vsize = Vector_size(this->processes);
-      // Find all processes whose parent is not visible
-      int size;
-      while ((size = Vector_size(this->processes))) {
-         int i = 0;
-         while(i < size) {
-            Process* process = (Process *)Vector_get(this->processes, i);
-            process->seen_in_tree_loop = false;
-            bool root = !ProcessList_findParent(this, process, NULL);
-            // If parent not found, then construct the tree with this root
-            if (!process->show || root) {
-               process = (Process *)Vector_take(this->processes, i);
-               process->indent = 0;
-               Vector_add(this->processes2, process);
-               int level = (!process->show && root) ? -1 : 0;
-               ProcessList_buildTree(this, process->pid, level, 0, direction, root && process->showChildren);
-               if(root) break;
-               size--;
-            } else {
-               i++;
-            }
-         }
-         /* Under some ptrace(2) implementations, a process
-          * ptrace(2)-attaching a parent process in its
-          * process tree will causing the traced process to be
-          * re-parented to the tracing process; this will
-          * creating a loop in the process tree. In this case
-          * build separated tree(s) for loop(s) left here.
-          */
-         if(i >= size) {
-            do {
-               Process *proc = (Process *)Vector_get(this->processes, size - 1);
-               /* This remaining process could
-                * either be a node at the loop it
-                * self, or a descendant node
-                * indirectly attached to the loop.
-                */
-#ifdef NDEBUG
-               i = size - 1;
-#endif
-               do {
-                  /* Make sure we break at the
-                   * loop itself, not a
-                   * descendant of it. */
-                  proc->seen_in_tree_loop = true;
-                  Process *parent = ProcessList_findParent(this, proc, &i);
-                  assert(parent != NULL);
-                  if(!parent) break;
-                  proc = parent;
-               } while(!proc->seen_in_tree_loop);
-#ifdef NDEBUG
-               Vector_take(this->processes, i);
-#else
-               Process *taken = (Process *)Vector_take(this->processes, i);
-               assert(taken == proc);
-#endif
-               proc->indent = 0;
-               Vector_add(this->processes2, proc);
-               ProcessList_buildTree(this, proc->pid, 0, 0, direction, proc->show);
-            } while((size = Vector_size(this->processes)) > 0);
-            break;
-         }
+      if (!ProcessList_sortByKey(this, ProcessList_sortWindow(this))) {
+         Vector_sort(this->processes);
+         this->sortedCount = Vector_size(this->processes);
       }
-      assert(Vector_size(this->processes2) == vsize); (void)vsize;
-      // Swap listings around
-      Vector* t = this->processes;
-      this->processes = this->processes2;
-      this->processes2 = t;
+   } else {
+      ProcessList_sortTree(this);
+      this->sortedCount = Vector_size(this->processes);
    }
 }
 
 
+// Puts the whole list in order before walking it, as searches do
+void ProcessList_completeSort(ProcessList* this) {
+   if (this->sortedCount >= Vector_size(this->processes)) return;
+   ProcessList_finishSort(this);
+   ProcessList_rebuildPanel(this);
+}
+
 ProcessField ProcessList_keyAt(ProcessList* this, int at) {
    int x = 0;
    const unsigned int *fields = this->settings->fields;
@@ -325,8 +699,43 @@ void ProcessList_expandTree(ProcessList* this) {
    }
 }
 
-void ProcessList_rebuildPanel(ProcessList* this) {
+static void ProcessList_invalidateFilter(ProcessList* this, bool refines) {
+   this->filterGeneration++;
+   // Generation 0 marks processes never matched
+   if (this->filterGeneration == 0) {
+      this->filterGeneration = 1;
+      refines = false;
+   }
+   this->filterRefines = refines;
+}
+
+static void ProcessList_updateFilter(ProcessList* this) {
+   // Notices a new incFilter, which its buffer in IncSet doesn't tell by itself
    const char* incFilter = this->incFilter;
+   const char* lastFilter = this->lastFilter;
+   if (incFilter ? lastFilter && String_eq(incFilter, lastFilter) : !lastFilter)
+      return;
+   // Commands containing the new filter contain the previous one too
+   ProcessList_invalidateFilter(this, incFilter && lastFilter && String_contains_i(incFilter, lastFilter));
+   free(this->lastFilter);
+   this->lastFilter = incFilter ? xStrdup(incFilter) : NULL;
+}
+
+static bool ProcessList_matchesFilter(const ProcessList* this, Process* p) {
+   unsigned int generation = this->filterGeneration;
+   if (p->filterGeneration == generation)
+      return p->filterMatch;
+   // A process the previous filter left out stays out of a narrower one
+   if (!this->filterRefines || p->filterGeneration != generation - 1 || p->filterMatch) {
+      p->filterMatch = (!this->incFilter || String_contains_i(p->comm, this->incFilter))
+         && (!this->pidWhiteList || Hashtable_get(this->pidWhiteList, p->tgid));
+   }
+   p->filterGeneration = generation;
+   return p->filterMatch;
+}
+
+void ProcessList_rebuildPanel(ProcessList* this) {
+   ProcessList_updateFilter(this);
 
    int currPos = Panel_getSelectedIndex(this->panel);
    pid_t currPid = this->following != -1 ? this->following : 0;
@@ -334,15 +743,18 @@ void ProcessList_rebuildPanel(ProcessList* this) {
 
    Panel_prune(this->panel);
    int size = ProcessList_size(this);
+   // The processes left unsorted are only put in order once the rows in
+   // sight reach them, or to find the followed process
+   int needed = this->following != -1 ? size : (currPos > currScrollV ? currPos : currScrollV) + this->panel->h + 1;
    int idx = 0;
    for (int i = 0; i < size; i++) {
       bool hidden = false;
+      if (i == this->sortedCount && idx < needed) ProcessList_finishSort(this);
       Process* p = ProcessList_get(this, i);
 
       if ( (!p->show)
          || (this->userId != (uid_t) -1 && p->ruid != this->userId && p->euid != this->userId)
-         || (incFilter && !(String_contains_i(p->comm, incFilter)))
-         || (this->pidWhiteList && !Hashtable_get(this->pidWhiteList, p->tgid)) ) {
+         || !ProcessList_matchesFilter(this, p) ) {
          hidden = true;
       }
 
@@ -382,17 +794,18 @@ static void read_zfs_arc_size(ProcessList *this) {
 	}
 }
 
-void ProcessList_scan(ProcessList* this, bool skip_processes) {
-   //if(!skip_processes) {
+static void ProcessList_sample(ProcessList* this, bool skip_processes) {
+   int i;
+   if(skip_processes || !this->scan_marks_processes) {
       // mark all process as "dirty"
-      int i = ProcessList_size(this);
+      i = ProcessList_size(this);
       while(i > 0) {
          Process *p = ProcessList_get(this, --i);
          p->created = false;
          p->updated = false;
          p->show = true;
       }
-   //}
+   }
 
    this->totalTasks = 0;
    this->thread_count = 0;
@@ -401,13 +814,235 @@ void ProcessList_scan(ProcessList* this, bool skip_processes) {
    this->running_process_count = 0;
    this->running_thread_count = 0;
 
+   // Platforms other than Linux don't tell which commands they update
+   if (!skip_processes && ProcessList_shouldUpdateProcessNames(this))
+      ProcessList_invalidateFilter(this, false);
+
    ProcessList_goThroughEntries(this, skip_processes);
    read_zfs_arc_size(this);
+}
 
-   for (i = Vector_size(this->processes) - 1; i >= 0; i--) {
-      Process* p = (Process*) Vector_get(this->processes, i);
-      if(!p->updated) ProcessList_remove(this, p);
-   }
+static void ProcessList_complete(ProcessList* this, bool skip_processes) {
+   // Drop the processes that are gone; done by the UI thread, as it frees them
+   ProcessListFilter filter = { .pl = this, .position = 0, .sortedRemoved = 0 };
+   Vector_filter(this->processes, ProcessList_keepUpdated, &filter);
+   this->sortedCount -= filter.sortedRemoved;
+   assert(Hashtable_count(this->processTable) == Vector_count(this->processes));
+   ProcessList_adoptRoots(this);
+
+   // The sort key may be a column no longer shown
+   const Settings* settings = this->settings;
+   int flags = settings->flags;
+   if (settings->sortKey < Platform_numberOfFields) flags |= Process_fields[settings->sortKey].flags;
+   if (flags & PROCESS_FLAG_SUBTREE) ProcessList_aggregateTree(this);
 
    if(!skip_processes) this->should_update_names = false;
 }
+
+void ProcessList_scan(ProcessList* this, bool skip_processes) {
+   ProcessList_finishScan(this, true);
+   ProcessList_sample(this, skip_processes);
+   ProcessList_complete(this, skip_processes);
+}
+
+#ifdef HAVE_PTHREAD
+
+static void* ProcessList_runScanner(void* arg) {
+   ProcessList* this = arg;
+   ProcessListScanner* scanner = this->scanner;
+   pthread_mutex_lock(&scanner->lock);
+   while (true) {
+      while (!scanner->requested && !scanner->quit) pthread_cond_wait(&scanner->changed, &scanner->lock);
+      if (scanner->quit) break;
+      scanner->requested = false;
+      scanner->background = true;
+      pthread_mutex_unlock(&scanner->lock);
+      ProcessList_enterScan(this);
+      ProcessList_sample(this, false);
+      pthread_mutex_lock(&scanner->lock);
+      scanner->running--;
+      scanner->background = false;
+      scanner->sampled = true;
+      pthread_cond_broadcast(&scanner->changed);
+      ssize_t written = write(scanner->wakeFds[1], "", 1);
+      (void) written;
+   }
+   pthread_mutex_unlock(&scanner->lock);
+   return NULL;
+}
+
+static bool ProcessList_startScanner(ProcessList* this) {
+   if (this->scanner) return true;
+   ProcessListScanner* scanner = xCalloc(1, sizeof(ProcessListScanner));
+   if (pipe(scanner->wakeFds) < 0) {
+      free(scanner);
+      return false;
+   }
+   fcntl(scanner->wakeFds[0], F_SETFL, O_NONBLOCK);
+   pthread_mutex_init(&scanner->lock, NULL);
+   pthread_cond_init(&scanner->changed, NULL);
+   scanner->uiHolding = true;
+   this->scanner = scanner;
+   if (pthread_create(&scanner->thread, NULL, ProcessList_runScanner, this) != 0) {
+      close(scanner->wakeFds[0]);
+      close(scanner->wakeFds[1]);
+      pthread_cond_destroy(&scanner->changed);
+      pthread_mutex_destroy(&scanner->lock);
+      free(scanner);
+      this->scanner = NULL;
+      return false;
+   }
+   return true;
+}
+
+#endif
+
+/*
+ * Starts a scan of the processes, on the scanner thread if background is set
+ * and threads are available. Until ProcessList_finishScan returns true, the
+ * processes may be updated but none is added to the panel or freed.
+ */
+void ProcessList_startScan(ProcessList* this, bool background) {
+   if (this->scanPending) return;
+   this->scanPending = true;
+#ifdef HAVE_PTHREAD
+   if (background && ProcessList_startScanner(this)) {
+      ProcessListScanner* scanner = this->scanner;
+      pthread_mutex_lock(&scanner->lock);
+      scanner->requested = true;
+      scanner->sampled = false;
+      pthread_cond_broadcast(&scanner->changed);
+      pthread_mutex_unlock(&scanner->lock);
+      this->scanBackground = true;
+      return;
+   }
+#else
+   (void) background;
+#endif
+   ProcessList_sample(this, false);
+}
+
+/*
+ * Completes the scan started by ProcessList_startScan, if the processes have
+ * been read or wait is set. Returns whether there was such a scan.
+ */
+bool ProcessList_finishScan(ProcessList* this, bool wait) {
+   if (!this->scanPending) return false;
+#ifdef HAVE_PTHREAD
+   if (this->scanBackground) {
+      ProcessListScanner* scanner = this->scanner;
+      pthread_mutex_lock(&scanner->lock);
+      if (wait && !scanner->sampled) {
+         scanner->uiHolding = false;
+         pthread_cond_broadcast(&scanner->changed);
+         while (!scanner->sampled) pthread_cond_wait(&scanner->changed, &scanner->lock);
+         scanner->uiHolding = true;
+      }
+      bool sampled = scanner->sampled;
+      pthread_mutex_unlock(&scanner->lock);
+      if (!sampled) return false;
+      char buffer[16];
+      while (read(scanner->wakeFds[0], buffer, sizeof(buffer)) > 0);
+      this->scanBackground = false;
+   }
+#else
+   (void) wait;
+#endif
+   this->scanPending = false;
+   ProcessList_complete(this, false);
+   return true;
+}
+
+/*
+ * Descriptor that becomes readable when a background scan has read the
+ * processes, or -1 if none was started.
+ */
+int ProcessList_scanFd(const ProcessList* this) {
+#ifdef HAVE_PTHREAD
+   return this->scanner ? this->scanner->wakeFds[0] : -1;
+#else
+   (void) this;
+   return -1;
+#endif
+}
+
+/*
+ * Lets the scanner thread use the processes while the UI thread waits for
+ * keys; ProcessList_hold takes them back, after the scanning threads are done
+ * with their current chunk of work. In between, the held processes may be
+ * partly updated by the scan, but none of them are freed, that is left to
+ * ProcessList_finishScan on the UI thread.
+ */
+void ProcessList_release(ProcessList* this) {
+#ifdef HAVE_PTHREAD
+   ProcessListScanner* scanner = this->scanner;
+   if (!scanner) return;
+   pthread_mutex_lock(&scanner->lock);
+   scanner->uiHolding = false;
+   pthread_cond_broadcast(&scanner->changed);
+   pthread_mutex_unlock(&scanner->lock);
+#else
+   (void) this;
+#endif
+}
+
+void ProcessList_hold(ProcessList* this) {
+#ifdef HAVE_PTHREAD
+   ProcessListScanner* scanner = this->scanner;
+   if (!scanner) return;
+   pthread_mutex_lock(&scanner->lock);
+   scanner->uiWaiting = true;
+   while (scanner->running > 0) pthread_cond_wait(&scanner->changed, &scanner->lock);
+   scanner->uiWaiting = false;
+   scanner->uiHolding = true;
+   pthread_mutex_unlock(&scanner->lock);
+#else
+   (void) this;
+#endif
+}
+
+/*
+ * Called by the threads of a background scan around their use of the
+ * processes, and between chunks of work; these do nothing for scans done
+ * on the UI thread.
+ */
+void ProcessList_enterScan(ProcessList* this) {
+#ifdef HAVE_PTHREAD
+   ProcessListScanner* scanner = this->scanner;
+   if (!scanner || !scanner->background) return;
+   pthread_mutex_lock(&scanner->lock);
+   while (scanner->uiHolding || scanner->uiWaiting) pthread_cond_wait(&scanner->changed, &scanner->lock);
+   scanner->running++;
+   pthread_mutex_unlock(&scanner->lock);
+#else
+   (void) this;
+#endif
+}
+
+void ProcessList_leaveScan(ProcessList* this) {
+#ifdef HAVE_PTHREAD
+   ProcessListScanner* scanner = this->scanner;
+   if (!scanner || !scanner->background) return;
+   pthread_mutex_lock(&scanner->lock);
+   if (--scanner->running == 0) pthread_cond_broadcast(&scanner->changed);
+   pthread_mutex_unlock(&scanner->lock);
+#else
+   (void) this;
+#endif
+}
+
+void ProcessList_yieldScan(ProcessList* this) {
+#ifdef HAVE_PTHREAD
+   ProcessListScanner* scanner = this->scanner;
+   if (!scanner || !scanner->background) return;
+   pthread_mutex_lock(&scanner->lock);
+   if (scanner->uiWaiting) {
+      if (--scanner->running == 0) pthread_cond_broadcast(&scanner->changed);
+      while (scanner->uiHolding || scanner->uiWaiting) pthread_cond_wait(&scanner->changed, &scanner->lock);
+      scanner->running++;
+   }
+   pthread_mutex_unlock(&scanner->lock);
+#else
+   (void) this;
+#endif
+}
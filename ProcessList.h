@@ -9,6 +9,9 @@ Released under the GNU GPL, see the COPYING file
 in the source distribution for its full text.
 */
 
+#ifdef HAVE_PTHREAD
+#endif
+
 #include "Vector.h"
 #include "Hashtable.h"
 #include "UsersTable.h"
@@ -29,6 +32,12 @@ in the source distribution for its full text.
 #define MAX_READ 2048
 #endif
 
+// Below this many processes, sorting with the compare function is cheaper
+// than extracting the sort keys
+#define PROCESSLIST_KEY_SORT_MIN 256
+
+typedef struct ProcessListScanner_ ProcessListScanner;
+
 typedef struct ProcessList_ {
    Settings* settings;
 
@@ -42,6 +51,12 @@ typedef struct ProcessList_ {
    int following;
    uid_t userId;
    const char* incFilter;
+   // Bumped when the filters change, see Process.filterMatch
+   unsigned int filterGeneration;
+   // Copy of the incFilter last matched, and whether the current one only
+   // narrows down its matches
+   char* lastFilter;
+   bool filterRefines;
 
    #ifdef HAVE_LIBHWLOC
    hwloc_topology_t topology;
@@ -49,6 +64,26 @@ typedef struct ProcessList_ {
    #endif
 
    bool should_update_names;
+   // Processes without a parent in the list, linked like siblings
+   Process* treeRoots;
+   unsigned int treeGeneration;
+   // Keys of the processes and room to sort them, for ProcessList_sort
+   VectorSortKey* sortKeys;
+   int sortKeysSize;
+   // Leading processes in sort order; when the flat view is sorted only as
+   // far as the rows in sight, the others just follow them
+   int sortedCount;
+   // Set while the whole list has to be in order, such as while searching
+   bool sortAll;
+   // Set by platforms that reset the created, updated and show flags of
+   // processes by themselves while scanning
+   bool scan_marks_processes;
+   // Thread scanning in the background, started by the first ProcessList_startScan
+   ProcessListScanner* scanner;
+   // Set from ProcessList_startScan until ProcessList_finishScan, and while
+   // the scan runs on the scanner thread
+   bool scanPending;
+   bool scanBackground;
 
    int totalTasks;
    int thread_count;
@@ -77,6 +112,14 @@ void ProcessList_goThroughEntries(ProcessList *, bool);
 
 #define ProcessList_shouldUpdateProcessNames(THIS) ((THIS)->should_update_names || (THIS)->settings->updateProcessNames)
 
+// Whether a scan runs in the background, see ProcessList_startScan
+#define ProcessList_isScanning(THIS) ((THIS)->scanBackground)
+
+#ifdef HAVE_PTHREAD
+
+
+#endif
+
 ProcessList* ProcessList_init(ProcessList* this, ObjectClass* klass, UsersTable* usersTable, const Hashtable *pidWhiteList, uid_t userId);
 
 void ProcessList_done(ProcessList* this);
@@ -87,14 +130,20 @@ void ProcessList_printHeader(ProcessList* this, RichString* header);
 
 void ProcessList_add(ProcessList* this, Process* p);
 
-void ProcessList_remove(ProcessList* this, Process* p);
 
 Process* ProcessList_get(ProcessList* this, int idx);
 
 int ProcessList_size(ProcessList* this);
 
+
+
+#define ProcessTreeBuilder_isPlaced(this_, p_) ((p_)->treeGeneration == (this_)->generation)
+
 void ProcessList_sort(ProcessList* this);
 
+// Puts the whole list in order before walking it, as searches do
+void ProcessList_completeSort(ProcessList* this);
+
 ProcessField ProcessList_keyAt(ProcessList* this, int at);
 
 void ProcessList_expandTree(ProcessList* this);
@@ -105,4 +154,49 @@ Process* ProcessList_getProcess(ProcessList* this, pid_t pid, bool* preExisting,
 
 void ProcessList_scan(ProcessList* this, bool skip_processes);
 
+#ifdef HAVE_PTHREAD
+
+#endif
+
+/*
+ * Starts a scan of the processes, on the scanner thread if background is set
+ * and threads are available. Until ProcessList_finishScan returns true, the
+ * processes may be updated but none is added to the panel or freed.
+ */
+void ProcessList_startScan(ProcessList* this, bool background);
+
+/*
+ * Completes the scan started by ProcessList_startScan, if the processes have
+ * been read or wait is set. Returns whether there was such a scan.
+ */
+bool ProcessList_finishScan(ProcessList* this, bool wait);
+
+/*
+ * Descriptor that becomes readable when a background scan has read the
+ * processes, or -1 if none was started.
+ */
+int ProcessList_scanFd(const ProcessList* this);
+
+/*
+ * Lets the scanner thread use the processes while the UI thread waits for
+ * keys; ProcessList_hold takes them back, after the scanning threads are done
+ * with their current chunk of work. In between, the held processes may be
+ * partly updated by the scan, but none of them are freed, that is left to
+ * ProcessList_finishScan on the UI thread.
+ */
+void ProcessList_release(ProcessList* this);
+
+void ProcessList_hold(ProcessList* this);
+
+/*
+ * Called by the threads of a background scan around their use of the
+ * processes, and between chunks of work; these do nothing for scans done
+ * on the UI thread.
+ */
+void ProcessList_enterScan(ProcessList* this);
+
+void ProcessList_leaveScan(ProcessList* this);
+
+void ProcessList_yieldScan(ProcessList* this);
+
 #endif
@@ -25,8 +25,9 @@ in the source distribution for its full text.
 #define RichString_size(this) ((this)->chlen)
 #define RichString_sizeVal(this) ((this).chlen)
 
-#define RichString_begin(this) RichString (this); memset(&this, 0, sizeof(RichString)); (this).chptr = (this).chstr;
-#define RichString_beginAllocated(this) memset(&this, 0, sizeof(RichString)); (this).chptr = (this).chstr;
+// Only the terminator is cleared, the cells are written as they are used
+#define RichString_begin(this) RichString (this); RichString_beginAllocated(this)
+#define RichString_beginAllocated(this) (this).chlen = 0; (this).chptr = (this).chstr; memset((this).chstr, 0, sizeof(CharType));
 #define RichString_end(this) RichString_prune(&(this));
 
 #ifdef HAVE_LIBNCURSESW
@@ -46,6 +47,8 @@ in the source distribution for its full text.
 typedef struct RichString_ {
    int chlen;
    CharType* chptr;
+   // Cells allocated for chptr, when longer than RICHSTRING_MAXLEN
+   int chsize;
    CharType chstr[RICHSTRING_MAXLEN+1];
 } RichString;
 
@@ -57,19 +60,50 @@ typedef struct RichString_ {
 
 #define charBytes(n) (sizeof(CharType) * (n))
 
+static CharType* RichString_spare = NULL;
+static int RichString_spareSize = 0;
+
+static CharType* RichString_acquireBuffer(int size, int* allocated) {
+   // RichString_spare is the buffer of the last long string released, kept
+   // for the next one, as the lines drawn are usually about as long from one
+   // to the next
+   if (RichString_spareSize >= size) {
+      CharType* buffer = RichString_spare;
+      *allocated = RichString_spareSize;
+      RichString_spare = NULL;
+      RichString_spareSize = 0;
+      return buffer;
+   }
+   *allocated = size;
+   return xMalloc(charBytes(size));
+}
+
+static void RichString_releaseBuffer(CharType* buffer, int size) {
+   if (size <= RichString_spareSize) {
+      free(buffer);
+      return;
+   }
+   free(RichString_spare);
+   RichString_spare = buffer;
+   RichString_spareSize = size;
+}
+
 static void RichString_extendLen(RichString* this, int len) {
    if (this->chlen <= RICHSTRING_MAXLEN) {
       if (len > RICHSTRING_MAXLEN) {
-         this->chptr = xMalloc(charBytes(len + 1));
+         this->chptr = RichString_acquireBuffer(len + 1, &this->chsize);
          memcpy(this->chptr, this->chstr, charBytes(this->chlen));
       }
    } else {
       if (len <= RICHSTRING_MAXLEN) {
          memcpy(this->chstr, this->chptr, charBytes(len));
-         free(this->chptr);
+         RichString_releaseBuffer(this->chptr, this->chsize);
          this->chptr = this->chstr;
-      } else {
-         this->chptr = xRealloc(this->chptr, charBytes(len + 1));
+      } else if (len >= this->chsize) {
+         // Growing by half, as appending field by field would reallocate
+         // for each
+         this->chsize = len + 1 + this->chsize / 2;
+         this->chptr = xRealloc(this->chptr, charBytes(this->chsize));
       }
    }
 
@@ -81,7 +115,7 @@ static void RichString_extendLen(RichString* this, int len) {
 
 #ifdef HAVE_LIBNCURSESW
 
-static inline void RichString_writeFrom(RichString* this, int attrs, const char *s, unsigned int from, size_t len) {
+static void RichString_writeWide(RichString* this, int attrs, const char *s, unsigned int from, size_t len) {
    wchar_t wcs[len];
    size_t wcs_len = mbstowcs(wcs, s, len);
    size_t new_len = from + (wcs_len == (size_t)-1 ? len : wcs_len);
@@ -92,6 +126,21 @@ static inline void RichString_writeFrom(RichString* this, int attrs, const char
    }
 }
 
+static inline void RichString_writeFrom(RichString* this, int attrs, const char *s, unsigned int from, size_t len) {
+   // Writes ASCII text directly, leaving the multibyte conversion to
+   // RichString_writeWide from the first byte that isn't.
+   RichString_setLen(this, from + len);
+   attrs &= 0xffffff;
+   for (size_t j = 0; j < len; j++) {
+      unsigned char c = s[j];
+      if (c >= 0x80) {
+         RichString_writeWide(this, attrs, s + j, from + j, len - j);
+         return;
+      }
+      this->chptr[from + j] = (CharType){ .attr = attrs, .chars = { c >= 32 && c < 127 ? c : L'?' } };
+   }
+}
+
 inline void RichString_setAttrn(RichString* this, int attrs, int start, int finish) {
    cchar_t* ch = this->chptr + start;
    finish = CLAMP(finish, 0, this->chlen - 1);
@@ -146,9 +195,8 @@ int RichString_findChar(RichString* this, char c, int start) {
 
 void RichString_prune(RichString* this) {
    if (this->chlen > RICHSTRING_MAXLEN)
-      free(this->chptr);
-   memset(this, 0, sizeof(RichString));
-   this->chptr = this->chstr;
+      RichString_releaseBuffer(this->chptr, this->chsize);
+   RichString_beginAllocated(*this);
 }
 
 void RichString_setAttr(RichString* this, int attrs) {
@@ -163,6 +211,11 @@ void RichString_appendn(RichString* this, int attrs, const char* data, int len)
    RichString_writeFrom(this, attrs, data, this->chlen, len);
 }
 
+void RichString_setChars(RichString* this, const CharType* chars, int len) {
+   RichString_setLen(this, len);
+   memcpy(this->chptr, chars, charBytes(len));
+}
+
 void RichString_write(RichString* this, int attrs, const char* data) {
    RichString_writeFrom(this, attrs, data, 0, strlen(data));
 }
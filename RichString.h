@@ -22,8 +22,9 @@ in the source distribution for its full text.
 #define RichString_size(this) ((this)->chlen)
 #define RichString_sizeVal(this) ((this).chlen)
 
-#define RichString_begin(this) RichString (this); memset(&this, 0, sizeof(RichString)); (this).chptr = (this).chstr;
-#define RichString_beginAllocated(this) memset(&this, 0, sizeof(RichString)); (this).chptr = (this).chstr;
+// Only the terminator is cleared, the cells are written as they are used
+#define RichString_begin(this) RichString (this); RichString_beginAllocated(this)
+#define RichString_beginAllocated(this) (this).chlen = 0; (this).chptr = (this).chstr; memset((this).chstr, 0, sizeof(CharType));
 #define RichString_end(this) RichString_prune(&(this));
 
 #ifdef HAVE_LIBNCURSESW
@@ -43,6 +44,8 @@ in the source distribution for its full text.
 typedef struct RichString_ {
    int chlen;
    CharType* chptr;
+   // Cells allocated for chptr, when longer than RICHSTRING_MAXLEN
+   int chsize;
    CharType chstr[RICHSTRING_MAXLEN+1];
 } RichString;
 
@@ -77,6 +80,8 @@ void RichString_append(RichString* this, int attrs, const char* data);
 
 void RichString_appendn(RichString* this, int attrs, const char* data, int len);
 
+void RichString_setChars(RichString* this, const CharType* chars, int len);
+
 void RichString_write(RichString* this, int attrs, const char* data);
 
 #endif
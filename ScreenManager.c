@@ -40,6 +40,7 @@ typedef struct ScreenManager_ {
 #include "CRT.h"
 #include "local-curses.h"
 #include <assert.h>
+#include <stdio.h>
 #include <time.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -49,6 +50,14 @@ typedef struct ScreenManager_ {
 #define ERR (-1)
 #endif
 
+#ifdef DEBUG
+// Bytes curses wrote to the terminal for the frames of ScreenManager_run,
+// reported when htop exits
+unsigned long ScreenManager_measuredFrames;
+unsigned long long ScreenManager_frameBytes;
+unsigned long long ScreenManager_maxFrameBytes;
+#endif
+
 ScreenManager* ScreenManager_new(int x1, int y1, int x2, int y2, Orientation orientation, Header *header, const Settings* settings, bool owner) {
    ScreenManager* this;
    this = xMalloc(sizeof(ScreenManager));
@@ -124,22 +133,138 @@ void ScreenManager_resize(ScreenManager* this, int x1, int y1, int x2, int y2) {
    // TODO: VERTICAL
 }
 
-static void checkRecalculation(ScreenManager* this, double* oldTime, int* sortTimeout, bool* redraw, bool *rescan, bool *timedOut) {
+static bool finishScan(ScreenManager* this, int* sortTimeout, bool wait) {
    ProcessList* pl = this->header->pl;
+   if (!ProcessList_finishScan(pl, wait)) return false;
+   if (*sortTimeout <= 0 || this->settings->treeView) {
+      ProcessList_sort(pl);
+      *sortTimeout = 1;
+   }
+   Header_sample(this->header);
+   return true;
+}
+
+static bool isNavigationKey(int ch) {
+   // Keys that only move around in the panels, handled while a scan goes on
+   switch (ch) {
+      case KEY_UP:
+      case KEY_DOWN:
+      case KEY_CTRL('P'):
+      case KEY_CTRL('N'):
+#ifdef KEY_C_UP
+      case KEY_C_UP:
+#endif
+#ifdef KEY_C_DOWN
+      case KEY_C_DOWN:
+#endif
+      case KEY_LEFT:
+      case KEY_RIGHT:
+      case KEY_PPAGE:
+      case KEY_NPAGE:
+      case KEY_CTRL('B'):
+      case KEY_CTRL('F'):
+      case KEY_HOME:
+      case KEY_END:
+      case KEY_WHEELUP:
+      case KEY_WHEELDOWN:
+         return true;
+      default:
+         return false;
+   }
+}
+
+static bool isProcessActionKey(int ch) {
+   // Keys acting on the selected or tagged processes, which are looked up
+   // by PID, so they don't need the scan to be done
+   switch (ch) {
+      case 'k':
+      case KEY_F(9):
+      case ']':
+      case '[':
+      case KEY_F(7):
+      case KEY_F(8):
+      case 'F':
+      case ' ':
+      case 'U':
+      case 'c':
+      case 'a':
+      case 'l':
+      case 'o':
+      case 's':
+      case 'e':
+      case 'A':
+      case 'S':
+         return true;
+      default:
+         return false;
+   }
+}
+
+static bool waitsForScan(const ScreenManager* this, const Panel* focused, int ch) {
+   // Sorting, filtering and setup wait for the scan to be done, so they see
+   // all of the processes that are still there; moving around and acting on
+   // processes go on while the scanner is paused, see ProcessList_hold
+   if (!this->header || isNavigationKey(ch)) return false;
+   const Panel* processPanel = this->header->pl->panel;
+   if (focused == processPanel) return Panel_isInsertMode(focused) || !isProcessActionKey(ch);
+   // Lists picked from beside the processes, such as the signal to send,
+   // leave them alone
+   for (int i = 0; i < this->panelCount; i++) {
+      if ((const Panel*) Vector_get(this->panels, i) == processPanel) return false;
+   }
+   return true;
+}
+
+#ifdef DEBUG
+static long long writtenBytes() {
+   // Bytes this thread passed to write(2), or -1 where /proc doesn't tell.
+   // Other threads' writes, such as the scanner waking the loop up, are left
+   // out, so around refresh() it counts what curses sent to the terminal.
+   FILE* file = fopen("/proc/thread-self/io", "r");
+   if (!file) return -1;
+   long long bytes = -1;
+   char line[64];
+   while (fgets(line, sizeof(line), file)) {
+      if (sscanf(line, "wchar: %lld", &bytes) == 1) break;
+   }
+   fclose(file);
+   return bytes;
+}
+#endif
 
+static long long monotonicTime() {
+   // Milliseconds from an unspecified point, in a clock that isn't set if possible
+#if defined HAVE_CLOCK_GETTIME && defined CLOCK_MONOTONIC
+   struct timespec ts;
+   if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+#endif
    struct timeval tv;
    gettimeofday(&tv, NULL);
-   double newTime = ((double)tv.tv_sec * 10) + ((double)tv.tv_usec / 100000);
-   *timedOut = (newTime - *oldTime > this->settings->delay);
-   if (*timedOut || newTime < *oldTime || newTime - *oldTime > 255) {
+   return tv.tv_sec * 1000LL + tv.tv_usec / 1000;
+}
+
+static void checkRecalculation(ScreenManager* this, long long* lastScan, long long* nextScan, long long* nextDraw, bool* drawPending, int* sortTimeout, bool* redraw, bool* redrawHeader, bool *rescan) {
+   ProcessList* pl = this->header->pl;
+
+   long long now = monotonicTime();
+   long long sampleInterval = Settings_sampleInterval(this->settings);
+   bool timedOut = now >= *nextScan;
+   if (timedOut || now < *lastScan) {
       // timed out or clock was obviously adjusted
       *rescan = true;
    }
    if (*rescan) {
+      // Refreshes are scanned in the background, while requested rescans and
+      // the first scan of the screen are waited for
+      bool background = timedOut && *lastScan > 0;
 #ifdef DISK_STATS
-      double interval = (newTime - *oldTime) / 10;
+      double interval = (double)(now - *lastScan) / 1000;
 #endif
-      *oldTime = newTime;
+      // Samples keep to their schedule whatever scanning and drawing take,
+      // unless they fell a whole interval behind
+      if (timedOut && now - *nextScan < sampleInterval) *nextScan += sampleInterval;
+      else *nextScan = now + sampleInterval;
+      *lastScan = now;
 #ifdef DISK_STATS
       if(this->header->disk_list) {
          DiskList_scan(this->header->disk_list, interval);
@@ -148,24 +273,38 @@ static void checkRecalculation(ScreenManager* this, double* oldTime, int* sortTi
             DiskList_sort(this->header->disk_list);
             *sortTimeout = 1;
          }
+         Header_sample(this->header);
+         *drawPending = true;
       } else
 #endif
       {
-         ProcessList_scan(pl, false);
-         if (*sortTimeout <= 0 || this->settings->treeView) {
-            ProcessList_sort(pl);
-            *sortTimeout = 1;
-         }
+         ProcessList_startScan(pl, background);
       }
-      *redraw = true;
    }
-   if (*redraw) {
+   bool rebuilt = false;
+   if (finishScan(this, sortTimeout, false)) {
+      // Finishing the scan freed the processes that exited, so the panel
+      // lets go of them right away, only drawing waits for the draw interval
+      ProcessList_rebuildPanel(pl);
+      rebuilt = true;
+      *drawPending = true;
+   }
+   // New samples are drawn at most once per draw interval
+   if (*drawPending && now >= *nextDraw) *redraw = true;
+   // Until the scan is finished, the panel keeps showing the previous processes
+   if (*redraw && !ProcessList_isScanning(pl)) {
 #ifdef DISK_STATS
       if(this->header->disk_list) DiskList_rebuildPanel(this->header->disk_list);
       else
 #endif
-      ProcessList_rebuildPanel(pl);
-      Header_draw(this->header);
+      if (!rebuilt) ProcessList_rebuildPanel(pl);
+      // Moving around leaves the header alone, new samples only draw the
+      // meters they changed
+      if (*redrawHeader) Header_draw(this->header);
+      else if (*drawPending) Header_drawChanged(this->header);
+      *redrawHeader = false;
+      *drawPending = false;
+      *nextDraw = now + this->settings->draw_interval_ms;
    }
    *rescan = false;
 }
@@ -191,30 +330,60 @@ void ScreenManager_run(ScreenManager* this, Panel** lastFocus, int* lastKey) {
    int focus = 0;
    Panel *focused_panel = setCurrentPanel((Panel*) Vector_get(this->panels, focus));
 
-   double oldTime = 0.0;
+   long long lastScan = 0;
+   long long nextScan = 0;
+   long long nextDraw = 0;
+   bool drawPending = false;
 
    int ch = ERR;
    int closeTimeout = 0;
 
-   bool timedOut = true;
    bool redraw = true;
+   bool redrawHeader = true;
    bool rescan = false;
    int sortTimeout = 0;
    int resetSortTimeout = 5;
 
    while (!quit) {
       if (this->header) {
-         checkRecalculation(this, &oldTime, &sortTimeout, &redraw, &rescan, &timedOut);
+         checkRecalculation(this, &lastScan, &nextScan, &nextDraw, &drawPending, &sortTimeout, &redraw, &redrawHeader, &rescan);
       }
       if (redraw) {
          ScreenManager_drawPanels(this, focus);
          Panel_placeCursor(focused_panel);
+#ifdef DEBUG
+         long long before = writtenBytes();
          refresh();
+         long long after = writtenBytes();
+         if (before >= 0 && after >= before) {
+            unsigned long long bytes = after - before;
+            ScreenManager_measuredFrames++;
+            ScreenManager_frameBytes += bytes;
+            ScreenManager_maxFrameBytes = MAX(ScreenManager_maxFrameBytes, bytes);
+         }
+#else
+         refresh();
+#endif
       }
 
       int prevCh = ch;
-      CRT_explicitDelay();
-      ch = getch();
+      bool early = false;
+      bool scanning = this->header && ProcessList_isScanning(this->header->pl);
+      if (this->header) {
+         ProcessList* pl = this->header->pl;
+         long long wakeUp = drawPending ? MIN(nextScan, nextDraw) : nextScan;
+         long long timeout = wakeUp - monotonicTime();
+         // A background scan that has read the processes wakes the loop up
+         if (scanning) CRT_watchFd(ProcessList_scanFd(pl), NULL, NULL);
+         ProcessList_release(pl);
+         ch = CRT_getKey(timeout > 0 ? (int)timeout : 0);
+         early = monotonicTime() < wakeUp;
+         ProcessList_hold(pl);
+         if (scanning) CRT_unwatchFd(ProcessList_scanFd(pl));
+      } else {
+         ch = CRT_getKey(-1);
+         early = true;
+      }
 
       HandlerResult result = IGNORED;
       if (ch == KEY_MOUSE) {
@@ -260,8 +429,13 @@ void ScreenManager_run(ScreenManager* this, Panel** lastFocus, int* lastKey) {
 #endif
       }
       if (ch == ERR) {
+         if (scanning) {
+            redraw = false;
+            continue;
+         }
          if(sortTimeout > 0) sortTimeout--;
-         if (prevCh == ch && !timedOut) {
+         // Keys failing before the wait is over mean the terminal is gone
+         if (prevCh == ch && early) {
             closeTimeout++;
             if (closeTimeout == 100) {
                break;
@@ -284,7 +458,14 @@ void ScreenManager_run(ScreenManager* this, Panel** lastFocus, int* lastKey) {
             case KEY_ALT('L'): ch = KEY_RIGHT; break;
          }
       }
+      if (waitsForScan(this, focused_panel, ch) && finishScan(this, &sortTimeout, true)) {
+         ProcessList_rebuildPanel(this->header->pl);
+         Header_drawChanged(this->header);
+         drawPending = false;
+      }
       redraw = true;
+      // Keys may open screens that draw over the header
+      if (!isNavigationKey(ch)) redrawHeader = true;
       if (Panel_eventHandlerFn(focused_panel)) {
          result = Panel_eventHandler(focused_panel, ch, repeat);
       }
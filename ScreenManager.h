@@ -40,6 +40,14 @@ typedef struct ScreenManager_ {
 #define ERR (-1)
 #endif
 
+#ifdef DEBUG
+// Bytes curses wrote to the terminal for the frames of ScreenManager_run,
+// reported when htop exits
+extern unsigned long ScreenManager_measuredFrames;
+extern unsigned long long ScreenManager_frameBytes;
+extern unsigned long long ScreenManager_maxFrameBytes;
+#endif
+
 ScreenManager* ScreenManager_new(int x1, int y1, int x2, int y2, Orientation orientation, Header *header, const Settings* settings, bool owner);
 
 void ScreenManager_delete(ScreenManager* this);
@@ -52,6 +60,9 @@ Panel* ScreenManager_remove(ScreenManager* this, int idx);
 
 void ScreenManager_resize(ScreenManager* this, int x1, int y1, int x2, int y2);
 
+#ifdef DEBUG
+#endif
+
 void ScreenManager_run(ScreenManager* this, Panel** lastFocus, int* lastKey);
 
 #endif
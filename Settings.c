@@ -38,6 +38,18 @@ typedef struct Settings_ {
 #endif
    int colorScheme;
    int delay;
+   // Milliseconds between samples, 0 for the delay, and at least between
+   // the redraws they cause, 0 to redraw after every sample
+   int sample_interval_ms;
+   int draw_interval_ms;
+   // Samples kept by graph meters, 0 for as many as the graph shows
+   int graph_history_length;
+   int scan_threads;
+   int slow_tier_interval;
+   int idle_tier_samples;
+   // Process count from which the flat view only sorts the rows in sight,
+   // 0 to always sort everything
+   int partial_sort_threshold;
 
    int cpuCount;
    int direction;
@@ -49,6 +61,8 @@ typedef struct Settings_ {
    bool countCPUsFromZero;
    bool detailedCPUTime;
    bool treeView;
+   // Order siblings in tree view by the sort key instead of by PID
+   bool tree_sort_siblings;
    bool showProgramPath;
    bool shadowOtherUsers;
    bool showThreadNames;
@@ -64,12 +78,14 @@ typedef struct Settings_ {
    bool updateProcessNames;
    bool accountGuestInCPUMeter;
    bool headerMargin;
-   bool explicit_delay;
    bool highlight_new_processes;
    bool tasks_meter_show_kernel_process_count;
    bool vi_mode;
    bool use_mouse;
    bool update_process_names_on_ctrl_l;
+#ifdef HAVE_LINUX_CN_PROC_H
+   bool use_proc_events;
+#endif
    int (*sort_strcmp)(const char *, const char *);
 
    char **unsupported_options;
@@ -94,6 +110,7 @@ typedef struct Settings_ {
 #include "CRT.h"
 
 #include <sys/stat.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
@@ -101,6 +118,12 @@ typedef struct Settings_ {
 
 #define DEFAULT_DELAY 15
 
+// Shortest sample_interval_ms accepted
+#define MIN_SAMPLE_INTERVAL_MS 10
+
+// Longest graph_history_length accepted, a week at a sample a second
+#define MAX_GRAPH_HISTORY_LENGTH (7 * 24 * 3600)
+
 void Settings_delete(Settings* this) {
    free(this->filename);
    free(this->fields);
@@ -199,6 +222,11 @@ static void readFields(unsigned int *fields, int* flags, const FieldData *field_
    String_freeArray(ids);
 }
 
+static int readClampedInt(const char* value, int min, int max) {
+   int n = atoi(value);
+   return n < min ? min : (n > max ? max : n);
+}
+
 static bool Settings_read(Settings* this, const char* fileName, bool should_preserve_unsupported) {
    CRT_dropPrivileges();
    FILE *f = fopen(fileName, "r");
@@ -233,6 +261,8 @@ static bool Settings_read(Settings* this, const char* fileName, bool should_pres
          this->direction = atoi(option[1]);
       } else if (String_eq(option[0], "tree_view")) {
          this->treeView = atoi(option[1]);
+      } else if (String_eq(option[0], "tree_sort_siblings")) {
+         this->tree_sort_siblings = atoi(option[1]);
       } else if (String_eq(option[0], "hide_kernel_processes") || String_eq(option[0], "hide_kernel_threads")) {
          this->hide_kernel_processes = atoi(option[1]);
       } else if (String_eq(option[0], "hide_thread_processes") || String_eq(option[0], "hide_userland_threads")) {
@@ -269,7 +299,7 @@ static bool Settings_read(Settings* this, const char* fileName, bool should_pres
       } else if(String_eq(option[0], "case_insensitive_sort")) {
          this->sort_strcmp = atoi(option[1]) ? strcasecmp : strcmp;
       } else if(String_eq(option[0], "explicit_delay")) {
-         this->explicit_delay = atoi(option[1]);
+         // No longer needed, accepted so it isn't kept as unsupported
       } else if(String_eq(option[0], "highlight_new_processes")) {
          this->highlight_new_processes = atoi(option[1]);
       } else if(String_eq(option[0], "tasks_meter_show_kernel_process_count")) {
@@ -280,10 +310,30 @@ static bool Settings_read(Settings* this, const char* fileName, bool should_pres
          this->use_mouse = atoi(option[1]);
       } else if(String_eq(option[0], "update_process_names_on_ctrl_l")) {
          this->update_process_names_on_ctrl_l = atoi(option[1]);
+#ifdef HAVE_LINUX_CN_PROC_H
+      } else if(String_eq(option[0], "use_proc_events")) {
+         this->use_proc_events = atoi(option[1]);
+#endif
       } else if (String_eq(option[0], "account_guest_in_cpu_meter")) {
          this->accountGuestInCPUMeter = atoi(option[1]);
       } else if (String_eq(option[0], "delay")) {
          this->delay = atoi(option[1]);
+      } else if(String_eq(option[0], "sample_interval_ms")) {
+         this->sample_interval_ms = atoi(option[1]);
+         if(this->sample_interval_ms < 0) this->sample_interval_ms = 0;
+         else if(this->sample_interval_ms > 0 && this->sample_interval_ms < MIN_SAMPLE_INTERVAL_MS) this->sample_interval_ms = MIN_SAMPLE_INTERVAL_MS;
+      } else if(String_eq(option[0], "draw_interval_ms")) {
+         this->draw_interval_ms = readClampedInt(option[1], 0, INT_MAX);
+      } else if(String_eq(option[0], "graph_history_length")) {
+         this->graph_history_length = readClampedInt(option[1], 0, MAX_GRAPH_HISTORY_LENGTH);
+      } else if(String_eq(option[0], "scan_threads")) {
+         this->scan_threads = readClampedInt(option[1], 1, INT_MAX);
+      } else if(String_eq(option[0], "slow_tier_interval")) {
+         this->slow_tier_interval = readClampedInt(option[1], 1, INT_MAX);
+      } else if(String_eq(option[0], "idle_tier_samples")) {
+         this->idle_tier_samples = readClampedInt(option[1], 1, INT_MAX);
+      } else if(String_eq(option[0], "partial_sort_threshold")) {
+         this->partial_sort_threshold = readClampedInt(option[1], 0, INT_MAX);
       } else if (String_eq(option[0], "color_scheme")) {
          this->colorScheme = CRT_getColorSchemeIndexForName(option[1]);
          if(this->colorScheme < 0) {
@@ -376,20 +426,30 @@ bool Settings_write(Settings* this) {
    fprintf(f, "highlight_threads=%d\n", (int) this->highlightThreads);
    fprintf(f, "highlight_kernel_processes=%d\n", (int)this->highlight_kernel_processes);
    fprintf(f, "tree_view=%d\n", (int) this->treeView);
+   fprintf(f, "tree_sort_siblings=%d\n", (int) this->tree_sort_siblings);
    fprintf(f, "header_margin=%d\n", (int) this->headerMargin);
    fprintf(f, "detailed_cpu_time=%d\n", (int) this->detailedCPUTime);
    fprintf(f, "cpu_count_from_zero=%d\n", (int) this->countCPUsFromZero);
    fprintf(f, "update_process_names=%d\n", (int) this->updateProcessNames);
    fprintf(f, "case_insensitive_sort=%d\n", (int)(this->sort_strcmp == strcasecmp));
-   fprintf(f, "explicit_delay=%d\n", (int)this->explicit_delay);
    fprintf(f, "highlight_new_processes=%d\n", (int)this->highlight_new_processes);
    fprintf(f, "tasks_meter_show_kernel_process_count=%d\n", (int)this->tasks_meter_show_kernel_process_count);
    fprintf(f, "vi_mode=%d\n", (int)this->vi_mode);
    fprintf(f, "use_mouse=%d\n", (int)this->use_mouse);
-   fprintf(f, "update_process_names_on_ctrl_l=%d", (int)this->update_process_names_on_ctrl_l);
+   fprintf(f, "update_process_names_on_ctrl_l=%d\n", (int)this->update_process_names_on_ctrl_l);
+#ifdef HAVE_LINUX_CN_PROC_H
+   fprintf(f, "use_proc_events=%d\n", (int)this->use_proc_events);
+#endif
    fprintf(f, "account_guest_in_cpu_meter=%d\n", (int) this->accountGuestInCPUMeter);
    fprintf(f, "color_scheme=%s\n", CRT_color_scheme_names[this->colorScheme]);
    fprintf(f, "delay=%d\n", this->delay);
+   fprintf(f, "sample_interval_ms=%d\n", this->sample_interval_ms);
+   fprintf(f, "draw_interval_ms=%d\n", this->draw_interval_ms);
+   fprintf(f, "graph_history_length=%d\n", this->graph_history_length);
+   fprintf(f, "scan_threads=%d\n", this->scan_threads);
+   fprintf(f, "slow_tier_interval=%d\n", this->slow_tier_interval);
+   fprintf(f, "idle_tier_samples=%d\n", this->idle_tier_samples);
+   fprintf(f, "partial_sort_threshold=%d\n", this->partial_sort_threshold);
    fprintf(f, "left_meters="); writeMeters(this, f, 0);
    fprintf(f, "left_meter_modes="); writeMeterModes(this, f, 0);
    fprintf(f, "right_meters="); writeMeters(this, f, 1);
@@ -461,6 +521,7 @@ Settings* Settings_new(int cpuCount, bool have_swap) {
    this->hide_high_level_processes = false;
 #endif
    this->treeView = false;
+   this->tree_sort_siblings = false;
    this->highlightBaseName = false;
    this->highlightMegabytes = false;
    this->detailedCPUTime = false;
@@ -490,12 +551,14 @@ Settings* Settings_new(int cpuCount, bool have_swap) {
    }
 #endif
    this->sort_strcmp = strcmp;
-   this->explicit_delay = false;
    this->highlight_new_processes = false;
    this->tasks_meter_show_kernel_process_count = true;
    this->vi_mode = false;
    this->use_mouse = true;
    this->update_process_names_on_ctrl_l = false;
+#ifdef HAVE_LINUX_CN_PROC_H
+   this->use_proc_events = false;
+#endif
 
    char* legacyDotfile = NULL;
    char *global_file_path = NULL;
@@ -533,6 +596,13 @@ Settings* Settings_new(int cpuCount, bool have_swap) {
    this->colorScheme = CRT_getDefaultColorScheme();
    this->changed = false;
    this->delay = DEFAULT_DELAY;
+   this->sample_interval_ms = 0;
+   this->draw_interval_ms = 0;
+   this->graph_history_length = 0;
+   this->scan_threads = 1;
+   this->slow_tier_interval = 1;
+   this->idle_tier_samples = 5;
+   this->partial_sort_threshold = 10000;
    bool ok = false;
    if (legacyDotfile) {
       ok = Settings_read(this, legacyDotfile, false);
@@ -572,3 +642,7 @@ Settings* Settings_new(int cpuCount, bool have_swap) {
 void Settings_invertSortOrder(Settings* this) {
    this->direction = (this->direction == 1) ? -1 : 1;
 }
+
+int Settings_sampleInterval(const Settings* this) {
+   return this->sample_interval_ms ? this->sample_interval_ms : this->delay * 100;
+}
@@ -41,6 +41,18 @@ typedef struct Settings_ {
 #endif
    int colorScheme;
    int delay;
+   // Milliseconds between samples, 0 for the delay, and at least between
+   // the redraws they cause, 0 to redraw after every sample
+   int sample_interval_ms;
+   int draw_interval_ms;
+   // Samples kept by graph meters, 0 for as many as the graph shows
+   int graph_history_length;
+   int scan_threads;
+   int slow_tier_interval;
+   int idle_tier_samples;
+   // Process count from which the flat view only sorts the rows in sight,
+   // 0 to always sort everything
+   int partial_sort_threshold;
 
    int cpuCount;
    int direction;
@@ -52,6 +64,8 @@ typedef struct Settings_ {
    bool countCPUsFromZero;
    bool detailedCPUTime;
    bool treeView;
+   // Order siblings in tree view by the sort key instead of by PID
+   bool tree_sort_siblings;
    bool showProgramPath;
    bool shadowOtherUsers;
    bool showThreadNames;
@@ -67,12 +81,14 @@ typedef struct Settings_ {
    bool updateProcessNames;
    bool accountGuestInCPUMeter;
    bool headerMargin;
-   bool explicit_delay;
    bool highlight_new_processes;
    bool tasks_meter_show_kernel_process_count;
    bool vi_mode;
    bool use_mouse;
    bool update_process_names_on_ctrl_l;
+#ifdef HAVE_LINUX_CN_PROC_H
+   bool use_proc_events;
+#endif
    int (*sort_strcmp)(const char *, const char *);
 
    char **unsupported_options;
@@ -91,6 +107,12 @@ typedef struct Settings_ {
 
 #define DEFAULT_DELAY 15
 
+// Shortest sample_interval_ms accepted
+#define MIN_SAMPLE_INTERVAL_MS 10
+
+// Longest graph_history_length accepted, a week at a sample a second
+#define MAX_GRAPH_HISTORY_LENGTH (7 * 24 * 3600)
+
 void Settings_delete(Settings* this);
 
 bool Settings_write(Settings* this);
@@ -100,4 +122,6 @@ Settings* Settings_new(int cpuCount, bool have_swap);
 
 void Settings_invertSortOrder(Settings* this);
 
+int Settings_sampleInterval(const Settings* this);
+
 #endif
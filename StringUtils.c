@@ -93,6 +93,24 @@ char* String_cat(const char* s1, const char* s2) {
    return out;
 }
 
+/*
+ * Sets *s to a copy of value, unless it holds the same string already.
+ * The current allocation is reused when value is no longer than it.
+ */
+void String_update(char** s, const char* value) {
+   size_t len = strlen(value);
+   if (*s) {
+      size_t oldLen = strlen(*s);
+      if (len <= oldLen) {
+         if (len < oldLen || memcmp(*s, value, len) != 0) memcpy(*s, value, len + 1);
+         return;
+      }
+      free(*s);
+   }
+   *s = xMalloc(len + 1);
+   memcpy(*s, value, len + 1);
+}
+
 char* String_trim(const char* in) {
    while (in[0] == ' ' || in[0] == '\t' || in[0] == '\n') {
       in++;
@@ -62,6 +62,12 @@ size_t strnlen(const char *s, size_t max_len);
 
 char* String_cat(const char* s1, const char* s2);
 
+/*
+ * Sets *s to a copy of value, unless it holds the same string already.
+ * The current allocation is reused when value is no longer than it.
+ */
+void String_update(char** s, const char* value);
+
 char* String_trim(const char* in);
 
 int String_eq(const char* s1, const char* s2);
@@ -49,7 +49,6 @@ InfoScreenClass TraceScreen_class = {
       .delete = TraceScreen_delete
    },
    .draw = TraceScreen_draw,
-   .onErr = TraceScreen_updateTrace,
    .onKey = TraceScreen_onKey,
 };
 
@@ -60,7 +59,6 @@ TraceScreen* TraceScreen_new(Process* process) {
    this->contLine = false;
    this->follow = false;
    FunctionBar* fuBar = FunctionBar_new(TraceScreenFunctions, TraceScreenKeys, TraceScreenEvents);
-   CRT_disableDelay();
    return (TraceScreen*) InfoScreen_init(&this->super, process, fuBar, LINES-2, "");
 }
 
@@ -69,9 +67,9 @@ void TraceScreen_delete(Object* cast) {
    if (this->child > 0) {
       kill(this->child, SIGTERM);
       waitpid(this->child, NULL, 0);
+      CRT_unwatchFd(this->trace_fd);
       close(this->trace_fd);
    }
-   CRT_enableDelay();
    free(InfoScreen_done((InfoScreen*)cast));
 }
 
@@ -114,24 +112,20 @@ bool TraceScreen_forkTracer(TraceScreen* this) {
    close(fdpair[1]);
    if(fcntl(fdpair[0], F_SETFL, O_NONBLOCK) == -1) return false;
    this->trace_fd = fdpair[0];
+   // Output is read as it comes, while InfoScreen_run waits for keys
+   CRT_watchFd(this->trace_fd, (CRT_FdHandler) TraceScreen_updateTrace, this);
    return true;
 }
 
 void TraceScreen_updateTrace(InfoScreen* super) {
    TraceScreen* this = (TraceScreen*) super;
    char buffer[1024];
-   int nready, len;
-   fd_set fds;
-   FD_ZERO(&fds);
-   FD_SET(this->trace_fd, &fds);
-   struct timeval timeout = { .tv_sec = 0, .tv_usec = 500 };
-   do {
-      nready = select(this->trace_fd + 1, &fds, NULL, NULL, &timeout);
-   } while(nready < 0 && errno == EINTR);
-   if(nready <= 0 || !FD_ISSET(this->trace_fd, &fds)) return;
+   int len;
    do {
       len = read(this->trace_fd, buffer, sizeof buffer - 1);
    } while(len < 0 && errno == EINTR);
+   // Nothing more will come once the tracer is gone
+   if(len == 0) CRT_unwatchFd(this->trace_fd);
    if(len < 1 || !this->tracing) return;
 
    char* line = buffer;
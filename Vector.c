@@ -8,6 +8,7 @@ in the source distribution for its full text.
 /*{
 #include "Object.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 #define swap(a_,x_,y_) do { void *tmp_ = (a_)[x_]; (a_)[x_] = (a_)[y_]; (a_)[y_] = tmp_; } while(0)
 
@@ -15,6 +16,14 @@ in the source distribution for its full text.
 #define DEFAULT_SIZE -1
 #endif
 
+typedef bool(*Vector_FilterFunction)(Object*, void*);
+
+// Sort key of an item, ordered as an unsigned integer
+typedef struct VectorSortKey_ {
+   uint64_t key;
+   Object* object;
+} VectorSortKey;
+
 typedef struct Vector_ {
    Object **array;
    ObjectClass* type;
@@ -156,6 +165,148 @@ static void insertionSort(Object** array, int left, int right, Object_Compare co
    }
 }
 
+// Shortest run worth merging is between MERGE_MIN_RUN / 2 and MERGE_MIN_RUN
+#define MERGE_MIN_RUN 64
+#define MERGE_MAX_RUNS 64
+
+static int mergeMinRun(int size) {
+   int odd = 0;
+   while (size >= MERGE_MIN_RUN) {
+      odd |= size & 1;
+      size >>= 1;
+   }
+   return size + odd;
+}
+
+static void binaryInsertionSort(Object** array, int left, int sorted, int right, Object_Compare compare) {
+   // Sorts array[left..right], of which array[left..sorted-1] is in order
+   for (int i = sorted; i <= right; i++) {
+      void* t = array[i];
+      int low = left;
+      int high = i;
+      // Equal items go after the ones already placed
+      while (low < high) {
+         int middle = low + (high - low) / 2;
+         comparisons++;
+         if (compare(t, array[middle]) < 0) high = middle;
+         else low = middle + 1;
+      }
+      memmove(array + low + 1, array + low, (i - low) * sizeof(Object*));
+      array[low] = t;
+   }
+}
+
+static int countRun(Object** array, int left, int right, Object_Compare compare) {
+   // Returns the end of the run starting at left, turning a descending run around
+   int end = left + 1;
+   if (end > right) return end;
+   comparisons++;
+   if (compare(array[end], array[left]) < 0) {
+      // Strictly descending only, to keep the sort stable
+      end++;
+      while (end <= right) {
+         comparisons++;
+         if (compare(array[end], array[end - 1]) >= 0) break;
+         end++;
+      }
+      for (int i = left, j = end - 1; i < j; i++, j--) {
+         swap(array, i, j);
+      }
+   } else {
+      end++;
+      while (end <= right) {
+         comparisons++;
+         if (compare(array[end], array[end - 1]) < 0) break;
+         end++;
+      }
+   }
+   return end;
+}
+
+static void mergeRuns(Object** array, int left, int middle, int right, Object** buffer, Object_Compare compare) {
+   // Merges the runs array[left..middle-1] and array[middle..right-1]
+   // Items of the left run that go before the whole right run stay put
+   int low = left;
+   int high = middle;
+   while (low < high) {
+      int m = low + (high - low) / 2;
+      comparisons++;
+      if (compare(array[middle], array[m]) < 0) high = m;
+      else low = m + 1;
+   }
+   left = low;
+   if (left == middle) return;
+   int leftSize = middle - left;
+   memcpy(buffer, array + left, leftSize * sizeof(Object*));
+   int i = 0, j = middle, k = left;
+   while (i < leftSize && j < right) {
+      comparisons++;
+      if (compare(array[j], buffer[i]) < 0) array[k++] = array[j++];
+      else array[k++] = buffer[i++];
+   }
+   memcpy(array + k, buffer + i, (leftSize - i) * sizeof(Object*));
+}
+
+static void mergeSort(Object** array, int size, Object_Compare compare) {
+   // Adaptive stable merge sort, after Tim Peters' listsort: the array is
+   // split into the runs already in order, short runs are extended with a
+   // binary insertion sort and the runs are merged in a balanced order. Input
+   // that is mostly in order takes close to n comparisons, any input
+   // O(n log n).
+   if (size < 2)
+      return;
+   int minRun = mergeMinRun(size);
+   Object** buffer = NULL;
+   int runStart[MERGE_MAX_RUNS];
+   int runSize[MERGE_MAX_RUNS];
+   int runs = 0;
+   int left = 0;
+   while (left < size) {
+      int end = countRun(array, left, size - 1, compare);
+      if (end - left < minRun) {
+         int forced = left + minRun < size ? left + minRun : size;
+         binaryInsertionSort(array, left, end, forced - 1, compare);
+         end = forced;
+      }
+      runStart[runs] = left;
+      runSize[runs] = end - left;
+      runs++;
+      left = end;
+      // Keep the pending runs growing like Fibonacci numbers from the top
+      // of the stack down, so merges stay balanced
+      while (runs > 1) {
+         int n = runs - 2;
+         if ((n > 0 && runSize[n - 1] <= runSize[n] + runSize[n + 1]) ||
+             (n > 1 && runSize[n - 2] <= runSize[n - 1] + runSize[n])) {
+            if (runSize[n - 1] < runSize[n + 1]) n--;
+         } else if (runSize[n] > runSize[n + 1]) {
+            break;
+         }
+         if (!buffer) buffer = xMalloc(size * sizeof(Object*));
+         mergeRuns(array, runStart[n], runStart[n + 1], runStart[n + 1] + runSize[n + 1], buffer, compare);
+         runSize[n] += runSize[n + 1];
+         for (int i = n + 1; i < runs - 1; i++) {
+            runStart[i] = runStart[i + 1];
+            runSize[i] = runSize[i + 1];
+         }
+         runs--;
+      }
+   }
+   while (runs > 1) {
+      int n = runs - 2;
+      if (n > 0 && runSize[n - 1] < runSize[n + 1]) n--;
+      if (!buffer) buffer = xMalloc(size * sizeof(Object*));
+      mergeRuns(array, runStart[n], runStart[n + 1], runStart[n + 1] + runSize[n + 1], buffer, compare);
+      runSize[n] += runSize[n + 1];
+      for (int i = n + 1; i < runs - 1; i++) {
+         runStart[i] = runStart[i + 1];
+         runSize[i] = runSize[i + 1];
+      }
+      runs--;
+   }
+   free(buffer);
+}
+
 void Vector_quickSort(Vector* this) {
    assert(this->items >= 0);
    assert(this->type->compare || !this->items);
@@ -172,6 +323,153 @@ void Vector_insertionSort(Vector* this) {
    assert(Vector_isConsistent(this));
 }
 
+// Stable, and fast on items left mostly in order from a previous sort
+void Vector_sort(Vector* this) {
+   assert(this->items >= 0);
+   assert(this->type->compare || !this->items);
+   assert(Vector_isConsistent(this));
+   mergeSort(this->array, this->items, this->type->compare);
+   assert(Vector_isConsistent(this));
+}
+
+// Sorts an array of objects not owned by a Vector, such as a slice of one
+void Vector_sortArray(Object** array, int size, Object_Compare compare) {
+   mergeSort(array, size, compare);
+}
+
+static VectorSortKey* radixSort(VectorSortKey* keys, VectorSortKey* buffer, int size) {
+   // Stable LSD radix sort of a byte per pass, skipping the bytes that are the
+   // same in all keys. Returns which of the keys and the buffer ends up sorted.
+   if (size < 2)
+      return keys;
+   int counts[8][256];
+   memset(counts, 0, sizeof(counts));
+   for (int i = 0; i < size; i++) {
+      uint64_t key = keys[i].key;
+      for (int byte = 0; byte < 8; byte++) {
+         counts[byte][(key >> (byte * 8)) & 0xff]++;
+      }
+   }
+   VectorSortKey* from = keys;
+   VectorSortKey* to = buffer;
+   for (int byte = 0; byte < 8; byte++) {
+      int* count = counts[byte];
+      int shift = byte * 8;
+      if (count[(from[0].key >> shift) & 0xff] == size) continue;
+      int offset = 0;
+      for (int digit = 0; digit < 256; digit++) {
+         int n = count[digit];
+         count[digit] = offset;
+         offset += n;
+      }
+      for (int i = 0; i < size; i++) {
+         to[count[(from[i].key >> shift) & 0xff]++] = from[i];
+      }
+      VectorSortKey* t = from;
+      from = to;
+      to = t;
+   }
+   return from;
+}
+
+static void storeSortedKeys(Object** array, const VectorSortKey* keys, int size, Object_Compare compare) {
+   // Stores sorted keys into the array, ordering runs of equal keys with compare
+   for (int i = 0; i < size; i++) {
+      array[i] = keys[i].object;
+   }
+   if (!compare)
+      return;
+   for (int i = 0; i < size; ) {
+      int j = i + 1;
+      while (j < size && keys[j].key == keys[i].key) j++;
+      if (j - i > 1) mergeSort(array + i, j - i, compare);
+      i = j;
+   }
+}
+
+/*
+ * Sorts the items by keys extracted beforehand, one per item. The buffer
+ * must be as large as the keys. When given, compare orders the items with
+ * equal keys, for keys that only partly order the items.
+ */
+void Vector_sortKeys(Vector* this, VectorSortKey* keys, VectorSortKey* buffer, Object_Compare compare) {
+   assert(Vector_isConsistent(this));
+   int size = this->items;
+   if (size < 2)
+      return;
+   storeSortedKeys(this->array, radixSort(keys, buffer, size), size, compare);
+   assert(Vector_isConsistent(this));
+}
+
+static uint64_t selectKey(VectorSortKey* keys, int size, int nth) {
+   // Returns the key that would be at index nth if the keys were sorted
+   int left = 0;
+   int right = size - 1;
+   while (left < right) {
+      uint64_t a = keys[left].key;
+      uint64_t b = keys[(left + right) / 2].key;
+      uint64_t c = keys[right].key;
+      uint64_t pivot = a < b ? (b < c ? b : (a < c ? c : a)) : (a < c ? a : (b < c ? c : b));
+      int i = left;
+      int j = right;
+      while (i <= j) {
+         while (keys[i].key < pivot) i++;
+         while (keys[j].key > pivot) j--;
+         if (i <= j) {
+            VectorSortKey t = keys[i];
+            keys[i++] = keys[j];
+            keys[j--] = t;
+         }
+      }
+      if (nth <= j) right = j;
+      else if (nth >= i) left = i;
+      else break;
+   }
+   return keys[nth].key;
+}
+
+/*
+ * Like Vector_sortKeys, but only puts in order the first count items, with
+ * the rest following in their current order. With compare, all the items
+ * with the same key as the last one in order are put in order too. Returns
+ * how many items are in order; sorting the others later completes a stable
+ * sort.
+ */
+int Vector_sortKeysPartially(Vector* this, VectorSortKey* keys, VectorSortKey* buffer, int count, Object_Compare compare) {
+   assert(Vector_isConsistent(this));
+   int size = this->items;
+   if (count >= size) {
+      Vector_sortKeys(this, keys, buffer, compare);
+      return size;
+   }
+   if (count <= 0)
+      return 0;
+   memcpy(buffer, keys, size * sizeof(VectorSortKey));
+   uint64_t last = selectKey(buffer, size, count - 1);
+   int less = 0;
+   int equal = 0;
+   for (int i = 0; i < size; i++) {
+      if (keys[i].key < last) less++;
+      else if (keys[i].key == last) equal++;
+   }
+   int take = compare ? equal : count - less;
+   int sorted = less + take;
+   // Partition stably, the items to sort into the buffer
+   Object** array = this->array;
+   int head = 0;
+   int tail = sorted;
+   for (int i = 0; i < size; i++) {
+      if (keys[i].key < last || (keys[i].key == last && take-- > 0)) {
+         buffer[head++] = keys[i];
+      } else {
+         array[tail++] = keys[i].object;
+      }
+   }
+   storeSortedKeys(array, radixSort(buffer, keys, sorted), sorted, compare);
+   assert(Vector_isConsistent(this));
+   return sorted;
+}
+
 static void Vector_checkArraySize(Vector* this) {
    assert(Vector_isConsistent(this));
    if (this->items >= this->arraySize) {
@@ -214,6 +512,26 @@ Object* Vector_take(Vector* this, int idx) {
    return removed;
 }
 
+/*
+ * Removes the objects for which keep returns false in a single pass,
+ * preserving the order of the others. Removed objects are deleted if the
+ * vector owns them.
+ */
+void Vector_filter(Vector* this, Vector_FilterFunction keep, void* data) {
+   assert(Vector_isConsistent(this));
+   int kept = 0;
+   for (int i = 0; i < this->items; i++) {
+      Object* o = this->array[i];
+      if (keep(o, data)) {
+         this->array[kept++] = o;
+      } else if (this->owner) {
+         Object_delete(o);
+      }
+   }
+   this->items = kept;
+   assert(Vector_isConsistent(this));
+}
+
 Object* Vector_remove(Vector* this, int idx) {
    Object* removed = Vector_take(this, idx);
    if (this->owner) {
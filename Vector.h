@@ -11,6 +11,7 @@ in the source distribution for its full text.
 
 #include "Object.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 #define swap(a_,x_,y_) do { void *tmp_ = (a_)[x_]; (a_)[x_] = (a_)[y_]; (a_)[y_] = tmp_; } while(0)
 
@@ -18,6 +19,14 @@ in the source distribution for its full text.
 #define DEFAULT_SIZE -1
 #endif
 
+typedef bool(*Vector_FilterFunction)(Object*, void*);
+
+// Sort key of an item, ordered as an unsigned integer
+typedef struct VectorSortKey_ {
+   uint64_t key;
+   Object* object;
+} VectorSortKey;
+
 typedef struct Vector_ {
    Object **array;
    ObjectClass* type;
@@ -44,14 +53,47 @@ void Vector_prune(Vector* this);
 
 */
 
+// Shortest run worth merging is between MERGE_MIN_RUN / 2 and MERGE_MIN_RUN
+#define MERGE_MIN_RUN 64
+#define MERGE_MAX_RUNS 64
+
 void Vector_quickSort(Vector* this);
 
 void Vector_insertionSort(Vector* this);
 
+// Stable, and fast on items left mostly in order from a previous sort
+void Vector_sort(Vector* this);
+
+// Sorts an array of objects not owned by a Vector, such as a slice of one
+void Vector_sortArray(Object** array, int size, Object_Compare compare);
+
+/*
+ * Sorts the items by keys extracted beforehand, one per item. The buffer
+ * must be as large as the keys. When given, compare orders the items with
+ * equal keys, for keys that only partly order the items.
+ */
+void Vector_sortKeys(Vector* this, VectorSortKey* keys, VectorSortKey* buffer, Object_Compare compare);
+
+/*
+ * Like Vector_sortKeys, but only puts in order the first count items, with
+ * the rest following in their current order. With compare, all the items
+ * with the same key as the last one in order are put in order too. Returns
+ * how many items are in order; sorting the others later completes a stable
+ * sort.
+ */
+int Vector_sortKeysPartially(Vector* this, VectorSortKey* keys, VectorSortKey* buffer, int count, Object_Compare compare);
+
 void Vector_insert(Vector* this, int idx, void* data_);
 
 Object* Vector_take(Vector* this, int idx);
 
+/*
+ * Removes the objects for which keep returns false in a single pass,
+ * preserving the order of the others. Removed objects are deleted if the
+ * vector owns them.
+ */
+void Vector_filter(Vector* this, Vector_FilterFunction keep, void* data);
+
 Object* Vector_remove(Vector* this, int idx);
 
 void Vector_moveUp(Vector* this, int idx);
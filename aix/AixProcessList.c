@@ -210,6 +210,7 @@ void ProcessList_goThroughEntries(ProcessList* super, bool skip_processes) {
 	}
 
 	for (int i = 0; i < count; i++) {
+		ProcessList_yieldScan(super);
 		bool preExisting;
 		struct procentry64 *pe = pes + i;
 		Process *proc = ProcessList_getProcess(super, pe->pi_pid, &preExisting, (Process_New) AixProcess_new);
@@ -205,6 +205,7 @@ void ProcessList_goThroughEntries(ProcessList* super, bool skip_processes) {
 	size_t count = ProcessList_updateProcessList(dpl);
 
 	for(size_t i = 0; i < count; i++) {
+		ProcessList_yieldScan(super);
 		bool preExisting;
 		const struct kinfo_proc *info = dpl->kip_buffer + i;
 		DarwinProcess *proc = (DarwinProcess *)ProcessList_getProcess(super, info->kp_proc.p_pid, &preExisting, (Process_New)DarwinProcess_new);
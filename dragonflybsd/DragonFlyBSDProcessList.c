@@ -426,6 +426,7 @@ void ProcessList_goThroughEntries(ProcessList* this, bool skip_processes) {
    int count = 0;
    struct kinfo_proc* kprocs = kvm_getprocs(dfpl->kd, KERN_PROC_ALL, 0, &count);
    for (int i = 0; i < count; i++) {
+      ProcessList_yieldScan(this);
       struct kinfo_proc* kproc = &kprocs[i];
       bool preExisting;
 
@@ -506,6 +506,7 @@ void ProcessList_goThroughEntries(ProcessList* this, bool skip_processes) {
 #endif
 
    for (int i = 0; i < count; i++) {
+      ProcessList_yieldScan(this);
       struct kinfo_proc* kproc = &kprocs[i];
       bool is_existing;
       Process* proc = ProcessList_getProcess(this, kproc->ki_pid, &is_existing, (Process_New) FreeBSDProcess_new);
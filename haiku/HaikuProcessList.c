@@ -233,6 +233,7 @@ void ProcessList_goThroughEntries(ProcessList *super, bool skip_processes) {
 	int32 team_cookie = 0;
 	team_info team_info;
 	while(get_next_team_info(&team_cookie, &team_info) == B_OK) {
+		ProcessList_yieldScan(super);
 		long int *nthr_p = NULL;
 		uid_t ruid, euid;
 		pid_t pgrp, session;
@@ -59,7 +59,7 @@ static void print_usage(FILE *f, const char *name) {
 #ifdef DISK_STATS
          "       --disk                  Show disk instead of process statistics\n"
 #endif
-         "       --explicit-delay        Explicitly delay between updates\n"
+         "       --explicit-delay        Ignored, kept for compatibility\n"
          "   -v, --version               Print version info\n"
          "\nArguments to long options are required for short options too.\n\n"
 #else
@@ -87,7 +87,6 @@ typedef struct CommandLineSettings_ {
    int delay;
    bool useColors;
    bool treeView;
-   bool explicit_delay;
 #ifdef DISK_STATS
    bool disk;
 #endif
@@ -102,7 +101,6 @@ static CommandLineSettings parseArguments(int argc, char** argv) {
       .delay = -1,
       .useColors = true,
       .treeView = false,
-      .explicit_delay = false,
    };
 
 #define HTOP_LONG_OPTION_EXPLICIT_DELAY (1 << 8)
@@ -136,7 +134,8 @@ static CommandLineSettings parseArguments(int argc, char** argv) {
       switch (opt) {
             char *p;
          case HTOP_LONG_OPTION_EXPLICIT_DELAY:
-            flags.explicit_delay = true;
+            // Keys are waited for with poll(), which the system time
+            // doesn't affect
             break;
 #ifdef DISK_STATS
          case HTOP_LONG_OPTION_DISK:
@@ -282,15 +281,17 @@ int main(int argc, char** argv) {
 
    Header_populateFromSettings(header);
 
-   if (flags.delay != -1) settings->delay = flags.delay;
+   // A delay given on the command line wins over sample_interval_ms
+   if (flags.delay != -1) {
+      settings->delay = flags.delay;
+      settings->sample_interval_ms = 0;
+   }
    // Use built-in MONOCHROME_COLOR_SCHEME for '--no-color'
    if (!flags.useColors) settings->colorScheme = MONOCHROME_COLOR_SCHEME;
    if (flags.treeView) settings->treeView = true;
-   if(flags.explicit_delay) settings->explicit_delay = true;
 
    CRT_init(settings);
    CRT_setMouse(settings->use_mouse);
-   CRT_setExplicitDelay(settings->explicit_delay);
 
    Panel *panel;
 #ifdef DISK_STATS
@@ -365,6 +366,14 @@ int main(int argc, char** argv) {
    attroff(CRT_colors[HTOP_DEFAULT_COLOR]);
    refresh();
    CRT_done();
+#ifdef DEBUG
+   fprintf(stderr, "Panels wrote %lu lines in %lu draws\n", Panel_writtenLines, Panel_drawCount);
+   if (ScreenManager_measuredFrames > 0) {
+      fprintf(stderr, "Frames sent %llu bytes to the terminal, %llu per frame and %llu at most, in %lu frames\n",
+         ScreenManager_frameBytes, ScreenManager_frameBytes / ScreenManager_measuredFrames,
+         ScreenManager_maxFrameBytes, ScreenManager_measuredFrames);
+   }
+#endif
    if (settings->changed) Settings_write(settings);
    Header_delete(header);
    ProcessList_delete(pl);
@@ -191,6 +191,7 @@ void ProcessList_goThroughEntries(ProcessList *super, bool skip_processes) {
 	error_t e = proc_getallpids(this->proc, &pids, &count);
 	if(e) error(1, e, "proc_getallpids");
 	for(size_t i = 0; i < count; i++) {
+		ProcessList_yieldScan(super);
 		pid_t pid = pids[i];
 		int flags = PI_FETCH_TASKINFO | PI_FETCH_THREADS | PI_FETCH_THREAD_BASIC;
 		struct procinfo *info = NULL;
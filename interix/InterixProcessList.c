@@ -56,6 +56,7 @@ void ProcessList_goThroughEntries(ProcessList *this, bool skip_processes) {
 	if(!dir) return;
 	struct dirent *e;
 	while((e = readdir(dir))) {
+		ProcessList_yieldScan(this);
 		bool is_existing;
 		uid_t ruid, euid;
 		unsigned long long int t;
@@ -19,6 +19,7 @@ in the source distribution for its full text.
 #endif
 #include <time.h>
 #include <errno.h>
+#include <assert.h>
 
 /*{
 
@@ -28,6 +29,17 @@ in the source distribution for its full text.
 #define PROCESS_FLAG_LINUX_CGROUP   0x0800
 #define PROCESS_FLAG_LINUX_OOM      0x1000
 
+// Pending changes reported by the proc connector
+#define LINUX_PROC_EVENT_EXEC 0x01
+#define LINUX_PROC_EVENT_UID  0x02
+#define LINUX_PROC_EVENT_EXIT 0x04
+// Exited process whose PID was taken by a new one, left to be dropped
+#define LINUX_PROC_EVENT_REUSED 0x08
+#define LINUX_PROC_EVENT_COMM 0x10
+// Process that forked and exited between two scans, known from the events
+// only and listed for one scan
+#define LINUX_PROC_EVENT_GONE 0x20
+
 typedef enum {
    HTOP_FLAGS_FIELD = 9,
    HTOP_ITREALVALUE_FIELD = 20,
@@ -90,7 +102,12 @@ typedef enum {
    HTOP_PERCENT_IO_DELAY_FIELD = 117,
    HTOP_PERCENT_SWAP_DELAY_FIELD = 118,
    #endif
-   HTOP_LAST_PROCESSFIELD = 119,
+   HTOP_TREE_PERCENT_CPU_FIELD = 119,
+   HTOP_TREE_M_RESIDENT_FIELD = 120,
+   #ifdef HAVE_TASKSTATS
+   HTOP_TREE_IO_RATE_FIELD = 121,
+   #endif
+   HTOP_LAST_PROCESSFIELD = 122,
 } LinuxProcessField;
 
 #include "IOPriority.h"
@@ -123,6 +140,8 @@ typedef struct LinuxProcess_ {
    unsigned long long io_rate_write_time;
    double io_rate_read_bps;
    double io_rate_write_bps;
+   // Sum of the known rates in the subtree, -1 if none is known
+   double subtree_io_rate;
    #endif
    #ifdef HAVE_OPENVZ
    unsigned int ctid;
@@ -145,12 +164,51 @@ typedef struct LinuxProcess_ {
    float blkio_delay_percent;
    float swapin_delay_percent;
    #endif
+   #ifdef HAVE_LINUX_CN_PROC_H
+   unsigned int proc_events;
+   #endif
+   unsigned int idle_samples;
+   bool details_stale;
+   // LinuxProcessList.cpu_period_sum when the process was last read
+   double cpu_period_sum;
+   int dir_fd;
+   int stat_fd;
+   int statm_fd;
+   unsigned int fd_cache_generation;
+   struct LinuxProcessFdCache_* fd_cache;
+   struct LinuxProcess_* fd_cache_prev;
+   struct LinuxProcess_* fd_cache_next;
 } LinuxProcess;
 
+// Processes that are allowed to keep their /proc file descriptors open,
+// in least recently used order
+typedef struct LinuxProcessFdCache_ {
+   LinuxProcess* first;
+   LinuxProcess* last;
+   int count;
+   int limit;
+} LinuxProcessFdCache;
+
+// Slabs of LinuxProcess objects, so processes that come and go reuse the
+// same memory instead of going through malloc each time
+typedef struct LinuxProcessPool_ {
+   LinuxProcess* free_list;
+   void** slabs;
+   int slab_count;
+   int slabs_size;
+   // Objects handed out and not yet returned, and the most at once
+   int in_use;
+   int peak_in_use;
+} LinuxProcessPool;
+
+#define LINUX_PROCESS_SLAB_SIZE 128
+
 }*/
 
 long long btime; /* semi-global */
 
+LinuxProcessPool LinuxProcess_pool;
+
 FieldData Process_fields[] = {
    [0] = { .name = "", .title = NULL, .description = NULL, .flags = 0, },
    [HTOP_PID_FIELD] = { .name = "PID", .title = "    PID ", .description = "Process/thread ID", .flags = 0, },
@@ -236,6 +294,11 @@ FieldData Process_fields[] = {
    [HTOP_PERCENT_CPU_DELAY_FIELD] = { .name = "PERCENT_CPU_DELAY", .title = "CPUD% ", .description = "CPU delay %", .flags = 0, },
    [HTOP_PERCENT_IO_DELAY_FIELD] = { .name = "PERCENT_IO_DELAY", .title = "IOD% ", .description = "Block I/O delay %", .flags = 0, },
    [HTOP_PERCENT_SWAP_DELAY_FIELD] = { .name = "PERCENT_SWAP_DELAY", .title = "SWAPD% ", .description = "Swapin delay %", .flags = 0, },
+#endif
+   [HTOP_TREE_PERCENT_CPU_FIELD] = { .name = "TREE_PERCENT_CPU", .title = "TCPU% ", .description = "Percentage of the CPU time used by the process and its descendants", .flags = PROCESS_FLAG_SUBTREE, },
+   [HTOP_TREE_M_RESIDENT_FIELD] = { .name = "TREE_M_RESIDENT", .title = " TRES ", .description = "Resident set size of the process and its descendants", .flags = PROCESS_FLAG_SUBTREE, },
+#ifdef HAVE_TASKSTATS
+   [HTOP_TREE_IO_RATE_FIELD] = { .name = "TREE_IO_RATE", .title = "   TREE R/W ", .description = "Total I/O rate of the process and its descendants", .flags = PROCESS_FLAG_IO | PROCESS_FLAG_SUBTREE, },
 #endif
    [HTOP_LAST_PROCESSFIELD] = { .name = "*** report bug! ***", .title = NULL, .description = NULL, .flags = 0, },
 };
@@ -253,6 +316,133 @@ ProcessPidColumn Process_pidColumns[] = {
    { .id = 0, .label = NULL }
 };
 
+static void LinuxProcess_addSubtree(Process* this, const Process* child) {
+   base_Process_addSubtree(this, child);
+   #ifdef HAVE_TASKSTATS
+   LinuxProcess* lp = (LinuxProcess*)this;
+   if (!child) {
+      lp->subtree_io_rate = lp->io_rate_read_bps >= 0 ? lp->io_rate_read_bps + lp->io_rate_write_bps : -1;
+      return;
+   }
+   double rate = ((const LinuxProcess*)child)->subtree_io_rate;
+   if (rate >= 0) lp->subtree_io_rate = (lp->subtree_io_rate >= 0 ? lp->subtree_io_rate : 0) + rate;
+   #endif
+}
+
+static ProcessSortKeyKind LinuxProcess_getSortKey(const Process* this, ProcessField field, uint64_t* key) {
+   const LinuxProcess* lp = (const LinuxProcess*)this;
+   switch ((int)field) {
+      case HTOP_M_DRS_FIELD:
+         *key = ~Process_signedSortKey(lp->m_drs);
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_M_DT_FIELD:
+         *key = ~Process_signedSortKey(lp->m_dt);
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_M_LRS_FIELD:
+         *key = ~Process_signedSortKey(lp->m_lrs);
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_M_TRS_FIELD:
+         *key = ~Process_signedSortKey(lp->m_trs);
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_M_SHARE_FIELD:
+         *key = ~Process_signedSortKey(lp->m_share);
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_UTIME_FIELD:
+         *key = ~(uint64_t)lp->utime;
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_CUTIME_FIELD:
+         *key = ~(uint64_t)lp->cutime;
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_STIME_FIELD:
+         *key = ~(uint64_t)lp->stime;
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_CSTIME_FIELD:
+         *key = ~(uint64_t)lp->cstime;
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_STARTTIME_FIELD:
+         *key = lp->starttime;
+         return PROCESS_SORT_KEY_PARTIAL;
+   #ifdef HAVE_TASKSTATS
+      case HTOP_RCHAR_FIELD:
+         *key = ~(uint64_t)lp->io_rchar;
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_WCHAR_FIELD:
+         *key = ~(uint64_t)lp->io_wchar;
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_SYSCR_FIELD:
+         *key = ~(uint64_t)lp->io_syscr;
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_SYSCW_FIELD:
+         *key = ~(uint64_t)lp->io_syscw;
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_RBYTES_FIELD:
+         *key = ~(uint64_t)lp->io_read_bytes;
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_WBYTES_FIELD:
+         *key = ~(uint64_t)lp->io_write_bytes;
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_CNCLWB_FIELD:
+         *key = ~(uint64_t)lp->io_cancelled_write_bytes;
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_IO_READ_RATE_FIELD:
+         *key = ~Process_floatSortKey(lp->io_rate_read_bps);
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_IO_WRITE_RATE_FIELD:
+         *key = ~Process_floatSortKey(lp->io_rate_write_bps);
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_IO_RATE_FIELD:
+         *key = ~Process_floatSortKey(lp->io_rate_read_bps + lp->io_rate_write_bps);
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_TREE_IO_RATE_FIELD:
+         *key = ~Process_floatSortKey(lp->subtree_io_rate);
+         return PROCESS_SORT_KEY_EXACT;
+   #endif
+   #ifdef HAVE_OPENVZ
+      case HTOP_CTID_FIELD:
+         *key = ~(uint64_t)lp->ctid;
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_VPID_FIELD:
+         *key = ~(uint64_t)lp->vpid;
+         return PROCESS_SORT_KEY_EXACT;
+   #endif
+   #ifdef HAVE_VSERVER
+      case HTOP_VXID_FIELD:
+         *key = ~(uint64_t)lp->vxid;
+         return PROCESS_SORT_KEY_EXACT;
+   #endif
+   #ifdef HAVE_CGROUP
+      case HTOP_CGROUP_FIELD:
+         *key = Process_stringSortKey(this->settings, lp->cgroup ? lp->cgroup : "");
+         return PROCESS_SORT_KEY_PARTIAL;
+   #endif
+      case HTOP_OOM_FIELD:
+         *key = ~(uint64_t)lp->oom;
+         return PROCESS_SORT_KEY_EXACT;
+   #ifdef HAVE_DELAYACCT
+      case HTOP_PERCENT_CPU_DELAY_FIELD:
+         *key = ~Process_floatSortKey(lp->cpu_delay_percent);
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_PERCENT_IO_DELAY_FIELD:
+         *key = ~Process_floatSortKey(lp->blkio_delay_percent);
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_PERCENT_SWAP_DELAY_FIELD:
+         *key = ~Process_floatSortKey(lp->swapin_delay_percent);
+         return PROCESS_SORT_KEY_EXACT;
+   #endif
+      case HTOP_IO_PRIORITY_FIELD:
+         *key = Process_signedSortKey(LinuxProcess_effectiveIOPriority(lp));
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_TREE_PERCENT_CPU_FIELD:
+         *key = ~Process_floatSortKey(this->subtree_percent_cpu);
+         return PROCESS_SORT_KEY_EXACT;
+      case HTOP_TREE_M_RESIDENT_FIELD:
+         *key = ~Process_signedSortKey(this->subtree_m_resident);
+         return PROCESS_SORT_KEY_EXACT;
+      default:
+         return base_Process_getSortKey(this, field, key);
+   }
+}
+
 ProcessClass LinuxProcess_class = {
    .super = {
       .extends = Class(Process),
@@ -261,23 +451,102 @@ ProcessClass LinuxProcess_class = {
       .compare = LinuxProcess_compare
    },
    .writeField = LinuxProcess_writeField,
+   .addSubtree = LinuxProcess_addSubtree,
+   .getSortKey = LinuxProcess_getSortKey,
 };
 
+static LinuxProcess* LinuxProcess_allocate() {
+   LinuxProcessPool* pool = &LinuxProcess_pool;
+   if (!pool->free_list) {
+      if (pool->slab_count >= pool->slabs_size) {
+         pool->slabs_size = pool->slabs_size ? pool->slabs_size * 2 : 16;
+         pool->slabs = xRealloc(pool->slabs, pool->slabs_size * sizeof(void*));
+      }
+      LinuxProcess* slab = xMalloc(LINUX_PROCESS_SLAB_SIZE * sizeof(LinuxProcess));
+      pool->slabs[pool->slab_count++] = slab;
+      for (int i = LINUX_PROCESS_SLAB_SIZE - 1; i >= 0; i--) {
+         *(LinuxProcess**)(slab + i) = pool->free_list;
+         pool->free_list = slab + i;
+      }
+   }
+   LinuxProcess* this = pool->free_list;
+   pool->free_list = *(LinuxProcess**)this;
+   pool->in_use++;
+   if (pool->in_use > pool->peak_in_use) pool->peak_in_use = pool->in_use;
+   memset(this, 0, sizeof(LinuxProcess));
+   return this;
+}
+
+static void LinuxProcess_free(LinuxProcess* this) {
+   LinuxProcessPool* pool = &LinuxProcess_pool;
+   *(LinuxProcess**)this = pool->free_list;
+   pool->free_list = this;
+   pool->in_use--;
+}
+
+/*
+ * Number of LinuxProcess objects the pool can hold without growing.
+ */
+int LinuxProcess_poolCapacity() {
+   return LinuxProcess_pool.slab_count * LINUX_PROCESS_SLAB_SIZE;
+}
+
+/*
+ * Frees the memory of the pool at once; every process must have been
+ * deleted already.
+ */
+void LinuxProcess_releasePool() {
+   LinuxProcessPool* pool = &LinuxProcess_pool;
+   assert(pool->in_use == 0);
+   for (int i = 0; i < pool->slab_count; i++) {
+      free(pool->slabs[i]);
+   }
+   free(pool->slabs);
+   memset(pool, 0, sizeof(LinuxProcessPool));
+}
+
 LinuxProcess* LinuxProcess_new(Settings* settings) {
-   LinuxProcess* this = xCalloc(1, sizeof(LinuxProcess));
+   LinuxProcess* this = LinuxProcess_allocate();
    Object_setClass(this, Class(LinuxProcess));
    Process_init(&this->super, settings);
+   this->dir_fd = -1;
+   this->stat_fd = -1;
+   this->statm_fd = -1;
    return this;
 }
 
+void LinuxProcess_closeCachedFds(LinuxProcess* this) {
+   if (this->dir_fd != -1) close(this->dir_fd);
+   if (this->stat_fd != -1) close(this->stat_fd);
+   if (this->statm_fd != -1) close(this->statm_fd);
+   this->dir_fd = -1;
+   this->stat_fd = -1;
+   this->statm_fd = -1;
+}
+
+void LinuxProcess_leaveFdCache(LinuxProcess* this) {
+   LinuxProcessFdCache* cache = this->fd_cache;
+   LinuxProcess_closeCachedFds(this);
+   if (!cache) return;
+   if (this->fd_cache_prev) this->fd_cache_prev->fd_cache_next = this->fd_cache_next;
+   else cache->first = this->fd_cache_next;
+   if (this->fd_cache_next) this->fd_cache_next->fd_cache_prev = this->fd_cache_prev;
+   else cache->last = this->fd_cache_prev;
+   this->fd_cache_prev = NULL;
+   this->fd_cache_next = NULL;
+   this->fd_cache = NULL;
+   cache->count--;
+}
+
 void Process_delete(Object* cast) {
    LinuxProcess* this = (LinuxProcess*) cast;
+   LinuxProcess_leaveFdCache(this);
    Process_done((Process*)cast);
 #ifdef HAVE_CGROUP
    free(this->cgroup);
 #endif
    free(this->ttyDevice);
-   free(this);
+   LinuxProcess_free(this);
 }
 
 /*
@@ -318,7 +587,7 @@ void LinuxProcess_printDelay(float delay_percent, char* buffer, int n) {
 }
 #endif
 
-void LinuxProcess_writeField(const Process *this, RichString* str, ProcessField field) {
+static void LinuxProcess_writeFieldText(const Process *this, RichString* str, ProcessField field) {
    const LinuxProcess *lp = (const LinuxProcess *)this;
    bool coloring = this->settings->highlightMegabytes;
    char buffer[256]; buffer[255] = '\0';
@@ -374,6 +643,14 @@ void LinuxProcess_writeField(const Process *this, RichString* str, ProcessField
          localtime_r(&start_wall_time, &tm);
          strftime(buffer, n, (start_wall_time > time(NULL) - 86400) ? "%R " : "%b%d ", &tm);
          break;
+      case HTOP_TREE_PERCENT_CPU_FIELD:
+         // One column wider than CPU%, for the larger totals
+         buffer[0] = ' ';
+         attr = Process_printPercentCpu(this->subtree_percent_cpu, buffer + 1, n - 1);
+         break;
+      case HTOP_TREE_M_RESIDENT_FIELD:
+         Process_humanNumber(str, this->subtree_m_resident * CRT_page_size_kib, coloring);
+         return;
    #ifdef HAVE_TASKSTATS
       case HTOP_RCHAR_FIELD:
          Process_colorNumber(str, lp->io_rchar, coloring);
@@ -406,6 +683,9 @@ void LinuxProcess_writeField(const Process *this, RichString* str, ProcessField
          total_rate = (lp->io_rate_read_bps >= 0) ? lp->io_rate_read_bps + lp->io_rate_write_bps : -1;
          Process_outputRate(str, buffer, n, total_rate, coloring);
          return;
+      case HTOP_TREE_IO_RATE_FIELD:
+         Process_outputRate(str, buffer, n, lp->subtree_io_rate, coloring);
+         return;
    #endif
    #ifdef HAVE_OPENVZ
       case HTOP_CTID_FIELD:
@@ -468,6 +748,51 @@ void LinuxProcess_writeField(const Process *this, RichString* str, ProcessField
    RichString_append(str, attr, buffer);
 }
 
+static bool LinuxProcess_isDetailField(ProcessField field) {
+   // Whether the field comes from a file that isn't read on every scan for
+   // processes in the slow tier
+   switch ((int)field) {
+      case HTOP_M_SIZE_FIELD:
+      case HTOP_M_RESIDENT_FIELD:
+      case HTOP_M_SHARE_FIELD:
+      case HTOP_M_TRS_FIELD:
+      case HTOP_M_DRS_FIELD:
+      case HTOP_M_LRS_FIELD:
+      case HTOP_M_DT_FIELD:
+      case HTOP_PERCENT_MEM_FIELD:
+   #ifdef HAVE_TASKSTATS
+      case HTOP_RCHAR_FIELD:
+      case HTOP_WCHAR_FIELD:
+      case HTOP_SYSCR_FIELD:
+      case HTOP_SYSCW_FIELD:
+      case HTOP_RBYTES_FIELD:
+      case HTOP_WBYTES_FIELD:
+      case HTOP_CNCLWB_FIELD:
+      case HTOP_IO_READ_RATE_FIELD:
+      case HTOP_IO_WRITE_RATE_FIELD:
+      case HTOP_IO_RATE_FIELD:
+      case HTOP_TREE_IO_RATE_FIELD:
+   #endif
+   #ifdef HAVE_CGROUP
+      case HTOP_CGROUP_FIELD:
+   #endif
+      case HTOP_OOM_FIELD:
+      case HTOP_TREE_M_RESIDENT_FIELD:
+         return true;
+      default:
+         return false;
+   }
+}
+
+void LinuxProcess_writeField(const Process *this, RichString* str, ProcessField field) {
+   int start = RichString_size(str);
+   LinuxProcess_writeFieldText(this, str, field);
+   // Values not updated in last scan are shadowed
+   if (((const LinuxProcess *)this)->details_stale && LinuxProcess_isDetailField(field)) {
+      RichString_setAttrn(str, CRT_colors[HTOP_PROCESS_SHADOW_COLOR], start, RichString_size(str) - 1);
+   }
+}
+
 long LinuxProcess_compare(const void* v1, const void* v2) {
    const LinuxProcess *p1, *p2;
    const Settings *settings = ((const Process *)v1)->settings;
@@ -525,6 +850,9 @@ long LinuxProcess_compare(const void* v1, const void* v2) {
       case HTOP_IO_RATE_FIELD:
          diff = (p2->io_rate_read_bps + p2->io_rate_write_bps) - (p1->io_rate_read_bps + p1->io_rate_write_bps);
          goto test_diff;
+      case HTOP_TREE_IO_RATE_FIELD:
+         diff = p2->subtree_io_rate - p1->subtree_io_rate;
+         goto test_diff;
    #endif
    #ifdef HAVE_OPENVZ
       case HTOP_CTID_FIELD:
@@ -552,6 +880,10 @@ long LinuxProcess_compare(const void* v1, const void* v2) {
    #endif
       case HTOP_IO_PRIORITY_FIELD:
          return LinuxProcess_effectiveIOPriority(p1) - LinuxProcess_effectiveIOPriority(p2);
+      case HTOP_TREE_PERCENT_CPU_FIELD:
+         return (p2->super.subtree_percent_cpu > p1->super.subtree_percent_cpu ? 1 : -1);
+      case HTOP_TREE_M_RESIDENT_FIELD:
+         return (p2->super.subtree_m_resident - p1->super.subtree_m_resident);
       default:
          return Process_compare(v1, v2);
       test_diff:
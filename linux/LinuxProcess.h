@@ -19,6 +19,17 @@ in the source distribution for its full text.
 #define PROCESS_FLAG_LINUX_CGROUP   0x0800
 #define PROCESS_FLAG_LINUX_OOM      0x1000
 
+// Pending changes reported by the proc connector
+#define LINUX_PROC_EVENT_EXEC 0x01
+#define LINUX_PROC_EVENT_UID  0x02
+#define LINUX_PROC_EVENT_EXIT 0x04
+// Exited process whose PID was taken by a new one, left to be dropped
+#define LINUX_PROC_EVENT_REUSED 0x08
+#define LINUX_PROC_EVENT_COMM 0x10
+// Process that forked and exited between two scans, known from the events
+// only and listed for one scan
+#define LINUX_PROC_EVENT_GONE 0x20
+
 typedef enum {
    HTOP_FLAGS_FIELD = 9,
    HTOP_ITREALVALUE_FIELD = 20,
@@ -81,7 +92,12 @@ typedef enum {
    HTOP_PERCENT_IO_DELAY_FIELD = 117,
    HTOP_PERCENT_SWAP_DELAY_FIELD = 118,
    #endif
-   HTOP_LAST_PROCESSFIELD = 119,
+   HTOP_TREE_PERCENT_CPU_FIELD = 119,
+   HTOP_TREE_M_RESIDENT_FIELD = 120,
+   #ifdef HAVE_TASKSTATS
+   HTOP_TREE_IO_RATE_FIELD = 121,
+   #endif
+   HTOP_LAST_PROCESSFIELD = 122,
 } LinuxProcessField;
 
 #include "IOPriority.h"
@@ -114,6 +130,8 @@ typedef struct LinuxProcess_ {
    unsigned long long io_rate_write_time;
    double io_rate_read_bps;
    double io_rate_write_bps;
+   // Sum of the known rates in the subtree, -1 if none is known
+   double subtree_io_rate;
    #endif
    #ifdef HAVE_OPENVZ
    unsigned int ctid;
@@ -136,19 +154,73 @@ typedef struct LinuxProcess_ {
    float blkio_delay_percent;
    float swapin_delay_percent;
    #endif
+   #ifdef HAVE_LINUX_CN_PROC_H
+   unsigned int proc_events;
+   #endif
+   unsigned int idle_samples;
+   bool details_stale;
+   // LinuxProcessList.cpu_period_sum when the process was last read
+   double cpu_period_sum;
+   int dir_fd;
+   int stat_fd;
+   int statm_fd;
+   unsigned int fd_cache_generation;
+   struct LinuxProcessFdCache_* fd_cache;
+   struct LinuxProcess_* fd_cache_prev;
+   struct LinuxProcess_* fd_cache_next;
 } LinuxProcess;
 
+// Processes that are allowed to keep their /proc file descriptors open,
+// in least recently used order
+typedef struct LinuxProcessFdCache_ {
+   LinuxProcess* first;
+   LinuxProcess* last;
+   int count;
+   int limit;
+} LinuxProcessFdCache;
+
+// Slabs of LinuxProcess objects, so processes that come and go reuse the
+// same memory instead of going through malloc each time
+typedef struct LinuxProcessPool_ {
+   LinuxProcess* free_list;
+   void** slabs;
+   int slab_count;
+   int slabs_size;
+   // Objects handed out and not yet returned, and the most at once
+   int in_use;
+   int peak_in_use;
+} LinuxProcessPool;
+
+#define LINUX_PROCESS_SLAB_SIZE 128
+
 
 extern long long btime;
 
+extern LinuxProcessPool LinuxProcess_pool;
+
 extern FieldData Process_fields[];
 
 extern ProcessPidColumn Process_pidColumns[];
 
 extern ProcessClass LinuxProcess_class;
 
+/*
+ * Number of LinuxProcess objects the pool can hold without growing.
+ */
+int LinuxProcess_poolCapacity();
+
+/*
+ * Frees the memory of the pool at once; every process must have been
+ * deleted already.
+ */
+void LinuxProcess_releasePool();
+
 LinuxProcess* LinuxProcess_new(Settings* settings);
 
+void LinuxProcess_closeCachedFds(LinuxProcess* this);
+
+void LinuxProcess_leaveFdCache(LinuxProcess* this);
+
 void Process_delete(Object* cast);
 
 /*
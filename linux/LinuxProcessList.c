@@ -27,7 +27,14 @@ in the source distribution for its full text.
 #include <string.h>
 #include <time.h>
 #include <assert.h>
+#include <limits.h>
+#include <stdint.h>
 #include <fcntl.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #ifdef MAJOR_IN_MKDEV
 #include <sys/mkdev.h>
 #elif defined MAJOR_IN_SYSMACROS
@@ -44,9 +51,17 @@ in the source distribution for its full text.
 #include <linux/taskstats.h>
 #endif
 
+#ifdef HAVE_LINUX_CN_PROC_H
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+#endif
+
 /*{
 
 #include "ProcessList.h"
+#include "LinuxProcess.h"
 
 extern long long btime;
 
@@ -84,6 +99,32 @@ typedef struct TtyDriver_ {
    unsigned int minorTo;
 } TtyDriver;
 
+typedef struct LinuxProcessScanEntry_ {
+   Process* process;
+   bool preExisting;
+   bool pinned;
+   // Left as it was, as nothing was reported about it since last scan
+   bool kept;
+   bool ok;
+} LinuxProcessScanEntry;
+
+typedef struct LinuxProcessPid_ {
+   pid_t pid;
+   pid_t tgid;
+} LinuxProcessPid;
+
+typedef struct LinuxProcessEvent_ {
+   // PROC_EVENT_FORK, PROC_EVENT_EXEC, PROC_EVENT_EXIT or PROC_EVENT_COMM
+   unsigned int what;
+   // Position in the order the events came in
+   int order;
+   pid_t pid;
+   pid_t tgid;
+   pid_t ppid;
+   // The command of the process, the parent's one for a fork, when known
+   char comm[16];
+} LinuxProcessEvent;
+
 typedef struct LinuxProcessList_ {
    ProcessList super;
    CPUData* cpus;
@@ -93,6 +134,35 @@ typedef struct LinuxProcessList_ {
    int netlink_family;
    #endif
    bool support_kthread_flag;
+   LinuxProcessScanEntry *scan_entries;
+   int scan_entries_size;
+   LinuxProcessFdCache fd_cache;
+   unsigned int scan_generation;
+   // Sum of the CPU periods of all scans, as processes may not be read on
+   // every scan
+   double cpu_period_sum;
+   char* dirent_buffer;
+   LinuxProcessPid* pids;
+   int pid_count;
+   int pids_size;
+   Process** pid_index;
+   int pid_index_count;
+   int pid_index_size;
+   bool pid_index_valid;
+   #ifdef HAVE_LINUX_CN_PROC_H
+   int proc_event_socket;
+   bool proc_event_socket_failed;
+   bool need_full_scan;
+   unsigned int scans_since_full_scan;
+   // Forks, and exits and command changes of processes not listed yet
+   LinuxProcessEvent* events;
+   int event_count;
+   int events_size;
+   // Processes that forked and exited since last scan, listed after it
+   LinuxProcessEvent* exited;
+   int exited_count;
+   int exited_size;
+   #endif
 } LinuxProcessList;
 
 #ifndef PROCDIR
@@ -129,6 +199,36 @@ typedef struct LinuxProcessList_ {
 #define CLAMP(x,low,high) (((x)>(high))?(high):(((x)<(low))?(low):(x)))
 #endif
 
+// Number of consecutive scan entries handed to a worker thread at once
+#define SCAN_CHUNK_SIZE 32
+
+// Upper limit for Settings.scan_threads
+#define MAX_SCAN_THREADS 256
+
+#define DIRENT_BUFFER_SIZE (256 * 1024)
+
+// File descriptors kept open by a process in the fd cache: the /proc/<pid>
+// directory, 'stat' and 'statm'
+#define CACHED_FDS_PER_PROCESS 3
+
+#ifndef O_PATH
+#define O_PATH O_RDONLY
+#endif
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+#ifdef HAVE_LINUX_CN_PROC_H
+// When tracking processes with the proc connector, still walk the whole
+// /proc on every this many scans, in case of missed events
+#define PROC_EVENTS_FULL_SCAN_INTERVAL 10
+
+#define PROC_EVENT_SOCKET_BUFFER_SIZE (1 << 20)
+#endif
+
+static long jiffy;
+
 static int sortTtyDrivers(const void* va, const void* vb) {
    const TtyDriver *a = (const TtyDriver *)va;
    const TtyDriver *b = (const TtyDriver *)vb;
@@ -225,11 +325,25 @@ ProcessList* ProcessList_new(UsersTable* usersTable, const Hashtable *pidWhiteLi
    ProcessList* pl = &(this->super);
 
    ProcessList_init(pl, Class(LinuxProcess), usersTable, pidWhiteList, userId);
+   pl->scan_marks_processes = true;
    LinuxProcessList_initTtyDrivers(this);
 
+   // Must be known before any worker thread starts reading processes
+   jiffy = sysconf(_SC_CLK_TCK);
+
+   // Leave half of the file descriptors for everything else
+   struct rlimit rl;
+   if (getrlimit(RLIMIT_NOFILE, &rl) < 0 || rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur > 1 << 20) {
+      rl.rlim_cur = 1 << 20;
+   }
+   this->fd_cache.limit = rl.rlim_cur / 2 / CACHED_FDS_PER_PROCESS;
+
    #ifdef HAVE_DELAYACCT
    LinuxProcessList_initNetlinkSocket(this);
    #endif
+   #ifdef HAVE_LINUX_CN_PROC_H
+   this->proc_event_socket = -1;
+   #endif
 
    // Update CPU count:
    unsigned int cpu_count = 0;
@@ -306,8 +420,17 @@ ProcessList* ProcessList_new(UsersTable* usersTable, const Hashtable *pidWhiteLi
 
 void ProcessList_delete(ProcessList* pl) {
    LinuxProcessList* this = (LinuxProcessList*) pl;
+#ifdef DEBUG
+   fprintf(stderr, "Process pool had %d processes at most and %d at exit, in %d slots\n",
+      LinuxProcess_pool.peak_in_use, LinuxProcess_pool.in_use, LinuxProcess_poolCapacity());
+#endif
    ProcessList_done(pl);
+   LinuxProcess_releasePool();
    free(this->cpus);
+   free(this->scan_entries);
+   free(this->dirent_buffer);
+   free(this->pids);
+   free(this->pid_index);
    if (this->ttyDrivers) {
       for(int i = 0; this->ttyDrivers[i].path; i++) {
          free(this->ttyDrivers[i].path);
@@ -320,28 +443,127 @@ void ProcessList_delete(ProcessList* pl) {
       nl_socket_free(this->netlink_socket);
    }
    #endif
+   #ifdef HAVE_LINUX_CN_PROC_H
+   if (this->proc_event_socket != -1) close(this->proc_event_socket);
+   free(this->events);
+   free(this->exited);
+   #endif
    free(this);
 }
 
 static inline unsigned long long LinuxProcess_adjustTime(unsigned long long t) {
-   static double jiffy = -1;
-   if(jiffy < 0) jiffy = sysconf(_SC_CLK_TCK);
-   double jiffytime = 1.0 / jiffy;
-   return (unsigned long long) t * jiffytime * 100;
+   // USER_HZ is 100 almost everywhere
+   return jiffy == 100 ? t : t * 100 / jiffy;
 }
 
-static bool LinuxProcessList_readStatFile(Process *process, const char* dirname, const char* name, char* command, int* commLen) {
-   LinuxProcess* lp = (LinuxProcess*) process;
+static int LinuxProcessList_openProcFile(LinuxProcess* lp, const char* dirname, const char* name, const char* file) {
+   // Opens a file in the /proc directory of the process, relative to the
+   // cached directory file descriptor if the process is in the fd cache.
    char filename[MAX_NAME];
-   xSnprintf(filename, MAX_NAME, "%s/%s/stat", dirname, name);
-   int fd = open(filename, O_RDONLY);
-   if (fd == -1)
-      return false;
+   if (lp->fd_cache) {
+      if (lp->dir_fd == -1) {
+         xSnprintf(filename, MAX_NAME, "%s/%s", dirname, name);
+         lp->dir_fd = open(filename, O_PATH | O_DIRECTORY | O_CLOEXEC);
+         if (lp->dir_fd == -1) return -1;
+      }
+      return openat(lp->dir_fd, file, O_RDONLY | O_CLOEXEC);
+   }
+   xSnprintf(filename, MAX_NAME, "%s/%s/%s", dirname, name, file);
+   return open(filename, O_RDONLY | O_CLOEXEC);
+}
 
-   static char buf[MAX_READ+1];
+static FILE* LinuxProcessList_fopenProcFile(LinuxProcess* lp, const char* dirname, const char* name, const char* file) {
+   int fd = LinuxProcessList_openProcFile(lp, dirname, name, file);
+   if (fd == -1) return NULL;
+   FILE* f = fdopen(fd, "r");
+   if (!f) close(fd);
+   return f;
+}
 
-   int size = xread(fd, buf, MAX_READ);
-   close(fd);
+static ssize_t LinuxProcessList_readHotFile(LinuxProcess* lp, int* fd, const char* dirname, const char* name, const char* file, char* buf, size_t size) {
+   // Reads a /proc file of the process that is read on every refresh. For
+   // processes in the fd cache, the file is kept open in *fd and re-read from
+   // the beginning; a failed read is retried once with a freshly opened file.
+   ssize_t len;
+   if (!lp->fd_cache) {
+      int tmp_fd = LinuxProcessList_openProcFile(lp, dirname, name, file);
+      if (tmp_fd == -1) return -1;
+      len = xread(tmp_fd, buf, size);
+      close(tmp_fd);
+      return len;
+   }
+   if (*fd != -1) {
+      len = xpread(*fd, buf, size, 0);
+      if (len > 0) return len;
+      close(*fd);
+   }
+   *fd = LinuxProcessList_openProcFile(lp, dirname, name, file);
+   if (*fd == -1) return -1;
+   return xread(*fd, buf, size);
+}
+
+// Field numbers of /proc/<pid>/stat, as listed in proc(5)
+#define STAT_FIELD_STATE 3
+#define STAT_FIELD_PPID 4
+#define STAT_FIELD_PGRP 5
+#define STAT_FIELD_SESSION 6
+#define STAT_FIELD_TTY_NR 7
+#define STAT_FIELD_TPGID 8
+#define STAT_FIELD_FLAGS 9
+#define STAT_FIELD_MINFLT 10
+#define STAT_FIELD_CMINFLT 11
+#define STAT_FIELD_MAJFLT 12
+#define STAT_FIELD_CMAJFLT 13
+#define STAT_FIELD_UTIME 14
+#define STAT_FIELD_STIME 15
+#define STAT_FIELD_CUTIME 16
+#define STAT_FIELD_CSTIME 17
+#define STAT_FIELD_PRIORITY 18
+#define STAT_FIELD_NICE 19
+#define STAT_FIELD_NUM_THREADS 20
+#define STAT_FIELD_STARTTIME 22
+#define STAT_FIELD_EXIT_SIGNAL 38
+#define STAT_FIELD_PROCESSOR 39
+
+typedef struct LinuxProcessStatLine_ {
+   char state;
+   // Number of the last field present; older kernels have fewer of them
+   int last_field;
+   long long fields[STAT_FIELD_PROCESSOR + 1];
+} LinuxProcessStatLine;
+
+static inline char* LinuxProcessList_parseStatNumber(char* p, long long* value) {
+   bool negative = *p == '-';
+   p += negative;
+   unsigned long long n = 0;
+   unsigned int digit;
+   while ((digit = (unsigned char)*p - '0') < 10) {
+      n = n * 10 + digit;
+      p++;
+   }
+   *value = negative ? -(long long)n : (long long)n;
+   return p;
+}
+
+static void LinuxProcessList_parseStatLine(char* location, LinuxProcessStatLine* stat) {
+   // Converts the numeric fields following the command of a stat line in a
+   // single pass, instead of going through strtol for each field separately.
+   int field = STAT_FIELD_STATE;
+   stat->state = *location;
+   if (*location) location++;
+   while (field < STAT_FIELD_PROCESSOR && *location == ' ') {
+      char* start = ++location;
+      location = LinuxProcessList_parseStatNumber(location, &stat->fields[field + 1]);
+      if (location == start) break;
+      field++;
+   }
+   stat->last_field = field;
+}
+
+static bool LinuxProcessList_readStatFile(Process *process, const char* dirname, const char* name, char* command, int* commLen) {
+   LinuxProcess* lp = (LinuxProcess*) process;
+   char buf[MAX_READ+1];
+   int size = LinuxProcessList_readHotFile(lp, &lp->stat_fd, dirname, name, "stat", buf, MAX_READ);
    if (size <= 0) return false;
    buf[size] = '\0';
 
@@ -351,64 +573,43 @@ static bool LinuxProcessList_readStatFile(Process *process, const char* dirname,
 
    location += 2;
    char *end = strrchr(location, ')');
-   if (!end) return false;
+   if (!end || !end[1]) return false;
    int commsize = end - location;
    memcpy(command, location, commsize);
    command[commsize] = '\0';
    *commLen = commsize;
-   location = end + 2;
-
-   process->state = location[0];
-   if(*++location != ' ' || !*++location) return false;
-   process->ppid = strtol(location, &location, 10);
-   if(*location != ' ' || !*++location) return false;
-   process->pgrp = strtoul(location, &location, 10);
-   if(*location != ' ' || !*++location) return false;
-   process->session = strtoul(location, &location, 10);
-   if(*location != ' ' || !*++location) return false;
-   process->tty_nr = strtol(location, &location, 10);
-   if(*location != ' ' || !*++location) return false;
-   process->tpgid = strtol(location, &location, 10);
-   if(*location != ' ' || !*++location) return false;
-   unsigned int flags = strtoul(location, &location, 10);
-   if(*location != ' ' || !*++location) return true;
-   lp->is_kernel_process = flags & PF_KTHREAD;
-   process->minflt = strtoull(location, &location, 10);
-   if(*location != ' ' || !*++location) return true;
-   lp->cminflt = strtoull(location, &location, 10);
-   if(*location != ' ' || !*++location) return true;
-   process->majflt = strtoull(location, &location, 10);
-   if(*location != ' ' || !*++location) return true;
-   lp->cmajflt = strtoull(location, &location, 10);
-   if(*location != ' ' || !*++location) return true;
-   lp->utime = LinuxProcess_adjustTime(strtoull(location, &location, 10));
-   if(*location != ' ' || !*++location) return true;
-   lp->stime = LinuxProcess_adjustTime(strtoull(location, &location, 10));
+
+   LinuxProcessStatLine stat;
+   LinuxProcessList_parseStatLine(end + 2, &stat);
+   if (stat.last_field < STAT_FIELD_FLAGS) return false;
+   const long long* fields = stat.fields;
+
+   process->state = stat.state;
+   process->ppid = fields[STAT_FIELD_PPID];
+   process->pgrp = fields[STAT_FIELD_PGRP];
+   process->session = fields[STAT_FIELD_SESSION];
+   process->tty_nr = fields[STAT_FIELD_TTY_NR];
+   process->tpgid = fields[STAT_FIELD_TPGID];
+   lp->is_kernel_process = (unsigned int)fields[STAT_FIELD_FLAGS] & PF_KTHREAD;
+   if (stat.last_field < STAT_FIELD_NUM_THREADS) return true;
+   process->minflt = fields[STAT_FIELD_MINFLT];
+   lp->cminflt = fields[STAT_FIELD_CMINFLT];
+   process->majflt = fields[STAT_FIELD_MAJFLT];
+   lp->cmajflt = fields[STAT_FIELD_CMAJFLT];
+   lp->utime = LinuxProcess_adjustTime(fields[STAT_FIELD_UTIME]);
+   lp->stime = LinuxProcess_adjustTime(fields[STAT_FIELD_STIME]);
    process->time = lp->utime + lp->stime;
-   if(*location != ' ' || !*++location) return true;
-   lp->cutime = LinuxProcess_adjustTime(strtoull(location, &location, 10));
-   if(*location != ' ' || !*++location) return true;
-   lp->cstime = LinuxProcess_adjustTime(strtoull(location, &location, 10));
-   if(*location != ' ' || !*++location) return true;
-   process->priority = strtol(location, &location, 10);
-   if(*location != ' ' || !*++location) return true;
-   process->nice = strtol(location, &location, 10);
-   if(*location != ' ' || !*++location) return true;
-   process->nlwp = strtol(location, &location, 10);
-   if(*location != ' ' || !*++location) return true;
-   location = strchr(location, ' ');
-   if(!location) return true;
-   location++;
-   lp->starttime = strtoll(location, &location, 10);
-   if(*location != ' ' || !*++location) return true;
-   for (int i=0; i<15; i++) {
-      location = strchr(location, ' ');
-      if(!location) return true;
-      location++;
-   }
-   process->exit_signal = strtol(location, &location, 10);
-   if(*location != ' ' || !*++location) return true;
-   process->processor = strtol(location, NULL, 10);
+   lp->cutime = LinuxProcess_adjustTime(fields[STAT_FIELD_CUTIME]);
+   lp->cstime = LinuxProcess_adjustTime(fields[STAT_FIELD_CSTIME]);
+   process->priority = fields[STAT_FIELD_PRIORITY];
+   process->nice = fields[STAT_FIELD_NICE];
+   process->nlwp = fields[STAT_FIELD_NUM_THREADS];
+   if (stat.last_field < STAT_FIELD_STARTTIME) return true;
+   lp->starttime = fields[STAT_FIELD_STARTTIME];
+   if (stat.last_field < STAT_FIELD_EXIT_SIGNAL) return true;
+   process->exit_signal = fields[STAT_FIELD_EXIT_SIGNAL];
+   if (stat.last_field < STAT_FIELD_PROCESSOR) return true;
+   process->processor = fields[STAT_FIELD_PROCESSOR];
    return true;
 }
 
@@ -472,9 +673,7 @@ static bool LinuxProcessList_getOwner(Process* process, int pid) {
 #ifdef HAVE_TASKSTATS
 
 static void LinuxProcessList_readIoFile(LinuxProcess* process, const char* dirname, char* name, unsigned long long now) {
-   char filename[MAX_NAME];
-   xSnprintf(filename, MAX_NAME, "%s/%s/io", dirname, name);
-   int fd = open(filename, O_RDONLY);
+   int fd = LinuxProcessList_openProcFile(process, dirname, name, "io");
    if (fd == -1) {
       process->io_rate_read_bps = -1;
       process->io_rate_write_bps = -1;
@@ -540,15 +739,10 @@ static void LinuxProcessList_readIoFile(LinuxProcess* process, const char* dirna
 
 
 static bool LinuxProcessList_readStatmFile(LinuxProcess* process, const char* dirname, const char* name) {
-   char filename[MAX_NAME];
-   xSnprintf(filename, MAX_NAME, "%s/%s/statm", dirname, name);
-   int fd = open(filename, O_RDONLY);
-   if (fd == -1)
-      return false;
    char buf[PROC_LINE_LENGTH + 1];
-   ssize_t rres = xread(fd, buf, PROC_LINE_LENGTH);
-   close(fd);
+   ssize_t rres = LinuxProcessList_readHotFile(process, &process->statm_fd, dirname, name, "statm", buf, PROC_LINE_LENGTH);
    if (rres < 1) return false;
+   buf[rres] = '\0';
 
    char *p = buf;
    errno = 0;
@@ -570,9 +764,7 @@ static void LinuxProcessList_readOpenVZData(LinuxProcess* process, const char* d
       process->ctid = 0;
       return;
    }
-   char filename[MAX_NAME];
-   xSnprintf(filename, MAX_NAME, "%s/%s/stat", dirname, name);
-   FILE* file = fopen(filename, "r");
+   FILE* file = LinuxProcessList_fopenProcFile(process, dirname, name, "stat");
    if (!file)
       return;
    (void) fscanf(file,
@@ -593,11 +785,9 @@ static void LinuxProcessList_readOpenVZData(LinuxProcess* process, const char* d
 #ifdef HAVE_CGROUP
 
 static void LinuxProcessList_readCGroupFile(LinuxProcess* process, const char* dirname, const char* name) {
-   char filename[MAX_NAME];
-   xSnprintf(filename, MAX_NAME, "%s/%s/cgroup", dirname, name);
-   FILE* file = fopen(filename, "r");
+   FILE* file = LinuxProcessList_fopenProcFile(process, dirname, name, "cgroup");
    if (!file) {
-      process->cgroup = xStrdup("");
+      String_update(&process->cgroup, "");
       return;
    }
    char output[PROC_LINE_LENGTH + 1];
@@ -619,8 +809,7 @@ static void LinuxProcessList_readCGroupFile(LinuxProcess* process, const char* d
       left -= wrote;
    }
    fclose(file);
-   free(process->cgroup);
-   process->cgroup = xStrdup(output);
+   String_update(&process->cgroup, output);
 }
 
 #endif
@@ -628,9 +817,7 @@ static void LinuxProcessList_readCGroupFile(LinuxProcess* process, const char* d
 #ifdef HAVE_VSERVER
 
 static void LinuxProcessList_readVServerData(LinuxProcess* process, const char* dirname, const char* name) {
-   char filename[MAX_NAME];
-   xSnprintf(filename, MAX_NAME, "%s/%s/status", dirname, name);
-   FILE* file = fopen(filename, "r");
+   FILE* file = LinuxProcessList_fopenProcFile(process, dirname, name, "status");
    if (!file)
       return;
    char buffer[PROC_LINE_LENGTH + 1];
@@ -659,9 +846,7 @@ static void LinuxProcessList_readVServerData(LinuxProcess* process, const char*
 #endif
 
 static void LinuxProcessList_readOomData(LinuxProcess* process, const char* dirname, const char* name) {
-   char filename[MAX_NAME];
-   xSnprintf(filename, MAX_NAME, "%s/%s/oom_score", dirname, name);
-   FILE* file = fopen(filename, "r");
+   FILE* file = LinuxProcessList_fopenProcFile(process, dirname, name, "oom_score");
    if (!file) {
       return;
    }
@@ -752,12 +937,11 @@ static void setCommand(Process* process, const char* command, int len) {
       process->comm = xStrdup(command);
    }
    process->commLen = len;
+   process->filterGeneration = 0;
 }
 
 static bool LinuxProcessList_readCmdlineFile(Process* process, const char* dirname, const char* name) {
-   char filename[MAX_NAME];
-   xSnprintf(filename, MAX_NAME, "%s/%s/cmdline", dirname, name);
-   int fd = open(filename, O_RDONLY);
+   int fd = LinuxProcessList_openProcFile((LinuxProcess*)process, dirname, name, "cmdline");
    if (fd == -1) return false;
    char command[4096+1]; // max cmdline length on Linux
    int amtRead = xread(fd, command, sizeof(command) - 1);
@@ -829,132 +1013,449 @@ static char* LinuxProcessList_updateTtyDevice(TtyDriver* ttyDrivers, dev_t tty_n
    return out;
 }
 
-static bool LinuxProcessList_recurseProcTree(LinuxProcessList* this, const char* dirname, Process* parent, double period, struct timeval tv) {
-   ProcessList* pl = (ProcessList*) this;
-   DIR* dir;
-   struct dirent* entry;
-   Settings* settings = pl->settings;
+static void LinuxProcessList_touchFdCache(LinuxProcessList* this, LinuxProcess* lp) {
+   // Marks the process as the most recently used one in the fd cache. A
+   // process that isn't in the cache only joins it if there is room left,
+   // possibly after evicting processes that weren't seen during this scan.
+   LinuxProcessFdCache* cache = &this->fd_cache;
+   lp->fd_cache_generation = this->scan_generation;
+   if (lp->fd_cache) {
+      if (cache->last == lp) return;
+      if (lp->fd_cache_prev) lp->fd_cache_prev->fd_cache_next = lp->fd_cache_next;
+      else cache->first = lp->fd_cache_next;
+      lp->fd_cache_next->fd_cache_prev = lp->fd_cache_prev;
+   } else {
+      while (cache->count >= cache->limit) {
+         LinuxProcess* lru = cache->first;
+         if (!lru || lru->fd_cache_generation == this->scan_generation) return;
+         LinuxProcess_leaveFdCache(lru);
+      }
+      lp->fd_cache = cache;
+      cache->count++;
+   }
+   lp->fd_cache_prev = cache->last;
+   lp->fd_cache_next = NULL;
+   if (cache->last) cache->last->fd_cache_next = lp;
+   else cache->first = lp;
+   cache->last = lp;
+}
 
-   #ifdef HAVE_TASKSTATS
-   unsigned long long now = tv.tv_sec*1000LL+tv.tv_usec/1000LL;
-   #endif
+static LinuxProcessScanEntry* LinuxProcessList_addScanEntry(LinuxProcessList* this, int* count, Process* proc, bool preExisting) {
+   if (*count >= this->scan_entries_size) {
+      this->scan_entries_size = this->scan_entries_size ? this->scan_entries_size * 2 : 256;
+      this->scan_entries = xRealloc(this->scan_entries, this->scan_entries_size * sizeof(LinuxProcessScanEntry));
+   }
+   LinuxProcessList_touchFdCache(this, (LinuxProcess*)proc);
+   LinuxProcessScanEntry* entry = this->scan_entries + (*count)++;
+   entry->process = proc;
+   entry->preExisting = preExisting;
+   // Processes on screen and the followed one are always fully updated
+   entry->pinned = proc->displayed || proc->pid == this->super.following;
+   entry->kept = false;
+   entry->ok = false;
+   proc->displayed = false;
+   return entry;
+}
 
-   dir = opendir(dirname);
+static int comparePids(const void* va, const void* vb) {
+   const LinuxProcessPid* a = va;
+   const LinuxProcessPid* b = vb;
+   return a->pid == b->pid ? 0 : (a->pid < b->pid ? -1 : 1);
+}
+
+static int compareProcessPids(const void* va, const void* vb) {
+   const Process* a = *(Process* const*)va;
+   const Process* b = *(Process* const*)vb;
+   return a->pid == b->pid ? 0 : (a->pid < b->pid ? -1 : 1);
+}
+
+static void LinuxProcessList_addPid(LinuxProcessList* this, pid_t pid, pid_t tgid) {
+   if (this->pid_count >= this->pids_size) {
+      this->pids_size = this->pids_size ? this->pids_size * 2 : 1024;
+      this->pids = xRealloc(this->pids, this->pids_size * sizeof(LinuxProcessPid));
+   }
+   this->pids[this->pid_count].pid = pid;
+   this->pids[this->pid_count].tgid = tgid;
+   this->pid_count++;
+}
+
+static void LinuxProcessList_addPidEntry(LinuxProcessList* this, const char* name, pid_t tgid) {
+   // The RedHat kernel hides threads with a dot.
+   // I believe this is non-standard.
+   if (*name == '.') name++;
+
+   // Just skip all non-number directories.
+   if (*name < '0' || *name > '9') return;
+   pid_t pid = 0;
+   do {
+      pid = pid * 10 + (*name++ - '0');
+   } while (*name >= '0' && *name <= '9');
+   if (*name) return;
+
+   if (pid <= 0 || pid == tgid) return;
+   LinuxProcessList_addPid(this, pid, tgid ? tgid : pid);
+}
+
+#ifdef SYS_getdents64
+struct linux_dirent64 {
+   uint64_t d_ino;
+   int64_t d_off;
+   unsigned short d_reclen;
+   unsigned char d_type;
+   char d_name[];
+};
+#endif
+
+static bool LinuxProcessList_readPidDir(LinuxProcessList* this, const char* dirname, pid_t tgid) {
+   // Appends the PIDs found in a /proc or /proc/<pid>/task directory to
+   // this->pids. If tgid is 0, each PID is its own thread group.
+#ifdef SYS_getdents64
+   int fd = open(dirname, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+   if (fd == -1) return false;
+   if (!this->dirent_buffer) this->dirent_buffer = xMalloc(DIRENT_BUFFER_SIZE);
+   long int len;
+   while ((len = syscall(SYS_getdents64, fd, this->dirent_buffer, DIRENT_BUFFER_SIZE)) > 0) {
+      long int pos = 0;
+      while (pos < len) {
+         const struct linux_dirent64* entry = (const struct linux_dirent64*)(this->dirent_buffer + pos);
+         LinuxProcessList_addPidEntry(this, entry->d_name, tgid);
+         pos += entry->d_reclen;
+      }
+   }
+   close(fd);
+#else
+   DIR* dir = opendir(dirname);
    if (!dir) return false;
-   int cpus = pl->cpuCount;
-   bool hide_kernel_processes = settings->hide_kernel_processes;
-   bool hide_thread_processes = settings->hide_thread_processes;
+   struct dirent* entry;
    while ((entry = readdir(dir)) != NULL) {
-      char* name = entry->d_name;
+      LinuxProcessList_addPidEntry(this, entry->d_name, tgid);
+   }
+   closedir(dir);
+#endif
+   return true;
+}
 
-      // The RedHat kernel hides threads with a dot.
-      // I believe this is non-standard.
-      if (name[0] == '.') {
-         name++;
+static void LinuxProcessList_enumeratePids(LinuxProcessList* this) {
+   // Lists the PIDs of all processes and threads in /proc into this->pids,
+   // sorted by PID.
+   this->pid_count = 0;
+   LinuxProcessList_readPidDir(this, PROCDIR, 0);
+   int process_count = this->pid_count;
+   for (int i = 0; i < process_count; i++) {
+      if (i % SCAN_CHUNK_SIZE == 0) ProcessList_yieldScan((ProcessList*) this);
+      char dirname[MAX_NAME];
+      pid_t pid = this->pids[i].pid;
+      xSnprintf(dirname, MAX_NAME, PROCDIR "/%d/task", (int)pid);
+      LinuxProcessList_readPidDir(this, dirname, pid);
+   }
+   // Each directory is usually listed in order already
+   for (int i = 1; i < this->pid_count; i++) {
+      if (this->pids[i - 1].pid > this->pids[i].pid) {
+         qsort(this->pids, this->pid_count, sizeof(LinuxProcessPid), comparePids);
+         break;
       }
+   }
+}
 
-      // Just skip all non-number directories.
-      if (name[0] < '0' || name[0] > '9') {
-         continue;
+static void LinuxProcessList_markProcess(Process* proc) {
+   proc->created = false;
+   proc->updated = false;
+   proc->show = true;
+}
+
+static void LinuxProcessList_joinProcesses(LinuxProcessList* this, int* count) {
+   // Walks the sorted PID list from LinuxProcessList_enumeratePids along with
+   // this->pid_index, the processes sorted by PID. Matching processes are
+   // collected into this->scan_entries, as well as new processes for PIDs
+   // that aren't in the index. Processes missing from the PID list are left
+   // not updated, so ProcessList_scan removes them. Only the directory
+   // listing is done here; reading the per-process files is left to
+   // LinuxProcessList_readProcess, which may run in multiple threads.
+   ProcessList* pl = (ProcessList*) this;
+   if (!this->pid_index_valid) {
+      int size = Vector_size(pl->processes);
+      if (size > this->pid_index_size) {
+         this->pid_index_size = size;
+         this->pid_index = xRealloc(this->pid_index, size * sizeof(Process*));
+      }
+      for (int i = 0; i < size; i++) {
+         this->pid_index[i] = (Process*) Vector_get(pl->processes, i);
       }
+      qsort(this->pid_index, size, sizeof(Process*), compareProcessPids);
+      this->pid_index_count = size;
+   }
 
-      // filename is a number: process directory
-      int pid = atoi(name);
-      if (parent && pid == parent->pid) continue;
-      if (pid <= 0) continue;
+   int j = 0;
+   for (int i = 0; i < this->pid_count; i++) {
+      pid_t pid = this->pids[i].pid;
+      if (i > 0 && pid == this->pids[i - 1].pid) continue;
+      if (i % SCAN_CHUNK_SIZE == 0) ProcessList_yieldScan(pl);
+      while (j < this->pid_index_count && this->pid_index[j]->pid < pid) {
+         LinuxProcessList_markProcess(this->pid_index[j++]);
+      }
+      Process* proc;
+      bool preExisting = j < this->pid_index_count && this->pid_index[j]->pid == pid;
+      if (preExisting) {
+         proc = this->pid_index[j++];
+         LinuxProcessList_markProcess(proc);
+         #ifdef HAVE_LINUX_CN_PROC_H
+         // A process known from events only, whose PID was taken since, is
+         // dropped first, and the new process is found by the next scan
+         if (((LinuxProcess*)proc)->proc_events & LINUX_PROC_EVENT_GONE) continue;
+         #endif
+      } else {
+         proc = (Process*) LinuxProcess_new(pl->settings);
+         proc->pid = pid;
+      }
+      proc->tgid = this->pids[i].tgid;
+      LinuxProcessList_addScanEntry(this, count, proc, preExisting);
+   }
+   while (j < this->pid_index_count) {
+      LinuxProcessList_markProcess(this->pid_index[j++]);
+   }
+}
 
-      bool preExisting = false;
-      Process* proc = ProcessList_getProcess(pl, pid, &preExisting, (Process_New) LinuxProcess_new);
-      proc->tgid = parent ? parent->pid : pid;
-      LinuxProcess* lp = (LinuxProcess*) proc;
+static bool LinuxProcessList_isSlowTier(const LinuxProcessList* this, const LinuxProcessScanEntry* entry) {
+   // Processes whose CPU time and state haven't changed for
+   // Settings.idle_tier_samples scans are moved to the slow tier, only having
+   // their 'stat' read on every scan; the other files are read every
+   // Settings.slow_tier_interval scans, spread over scans by PID.
+   const Settings* settings = this->super.settings;
+   const LinuxProcess* lp = (const LinuxProcess*) entry->process;
+   if (settings->slow_tier_interval <= 1 || !entry->preExisting || entry->pinned) return false;
+   #ifdef HAVE_LINUX_CN_PROC_H
+   if (lp->proc_events) return false;
+   #endif
+   if (lp->idle_samples < (unsigned int)settings->idle_tier_samples) return false;
+   return (this->scan_generation + lp->super.pid) % settings->slow_tier_interval != 0;
+}
 
-      char subdirname[MAX_NAME];
-      xSnprintf(subdirname, MAX_NAME, "%s/%s/task", dirname, name);
-      LinuxProcessList_recurseProcTree(this, subdirname, proc, period, tv);
+static bool LinuxProcessList_readProcess(LinuxProcessList* this, const LinuxProcessScanEntry* entry, double period, unsigned long long now) {
+   // Reads everything about a single process that doesn't touch the shared
+   // ProcessList state, so it is safe to be called from multiple threads as
+   // long as each process is handled by one thread only.
+   ProcessList* pl = (ProcessList*) this;
+   Settings* settings = pl->settings;
+   Process* proc = entry->process;
+   LinuxProcess* lp = (LinuxProcess*) proc;
+   bool preExisting = entry->preExisting;
+
+   char dirname[MAX_NAME];
+   char name[16];
+   if (proc->tgid == proc->pid) {
+      strcpy(dirname, PROCDIR);
+   } else {
+      xSnprintf(dirname, MAX_NAME, PROCDIR "/%d/task", (int)proc->tgid);
+   }
+   xSnprintf(name, sizeof name, "%d", (int)proc->pid);
+
+   char command[MAX_NAME+1];
+   unsigned long long int lasttimes = (lp->utime + lp->stime);
+   int last_state = proc->state;
+   int commLen = 0;
+   dev_t tty_nr = proc->tty_nr;
+   if (! LinuxProcessList_readStatFile(proc, dirname, name, command, &commLen)) {
+      return false;
+   }
+   if (lp->utime + lp->stime != lasttimes || proc->state != last_state) {
+      lp->idle_samples = 0;
+   } else if (lp->idle_samples < UINT_MAX) {
+      lp->idle_samples++;
+   }
 
+   lp->details_stale = LinuxProcessList_isSlowTier(this, entry);
+   if (!lp->details_stale) {
       #ifdef HAVE_TASKSTATS
       if (settings->flags & PROCESS_FLAG_IO)
          LinuxProcessList_readIoFile(lp, dirname, name, now);
       #endif
 
       if (! LinuxProcessList_readStatmFile(lp, dirname, name))
-         goto errorReadingProcess;
-
-      char command[MAX_NAME+1];
-      unsigned long long int lasttimes = (lp->utime + lp->stime);
-      int commLen = 0;
-      dev_t tty_nr = proc->tty_nr;
-      if (! LinuxProcessList_readStatFile(proc, dirname, name, command, &commLen)) {
-         goto errorReadingProcess;
+         return false;
+   }
+
+   String_update(&proc->name, command);
+   if(!this->support_kthread_flag && !lp->is_kernel_process) check_legacy_kernel_process(lp);
+   if (tty_nr != proc->tty_nr && this->ttyDrivers) {
+      free(lp->ttyDevice);
+      lp->ttyDevice = LinuxProcessList_updateTtyDevice(this->ttyDrivers, proc->tty_nr);
+   }
+   if (settings->flags & PROCESS_FLAG_LINUX_IOPRIO)
+      LinuxProcess_updateIOPriority(lp);
+   // Processes left as they were by some scans had their time counted over
+   // all of them
+   if (preExisting) period = this->cpu_period_sum - lp->cpu_period_sum;
+   lp->cpu_period_sum = this->cpu_period_sum;
+   float percent_cpu = (lp->utime + lp->stime - lasttimes) / period * 100.0;
+   proc->percent_cpu = CLAMP(percent_cpu, 0.0, pl->cpuCount * 100.0);
+   if (isnan(proc->percent_cpu)) proc->percent_cpu = 0.0;
+   proc->percent_mem = (proc->m_resident * CRT_page_size_kib) / (double)(pl->totalMem) * 100.0;
+
+   if(!preExisting) {
+
+      if (! LinuxProcessList_getOwner(proc, proc->pid))
+         return false;
+
+      #ifdef HAVE_OPENVZ
+      if (settings->flags & PROCESS_FLAG_LINUX_OPENVZ) {
+         LinuxProcessList_readOpenVZData(lp, dirname, name);
       }
-      free(proc->name);
-      proc->name = xStrdup(command);
-      if(!this->support_kthread_flag && !lp->is_kernel_process) check_legacy_kernel_process(lp);
-      if (tty_nr != proc->tty_nr && this->ttyDrivers) {
-         free(lp->ttyDevice);
-         lp->ttyDevice = LinuxProcessList_updateTtyDevice(this->ttyDrivers, proc->tty_nr);
+      #endif
+      #ifdef HAVE_VSERVER
+      if (settings->flags & PROCESS_FLAG_LINUX_VSERVER) {
+         LinuxProcessList_readVServerData(lp, dirname, name);
       }
-      if (settings->flags & PROCESS_FLAG_LINUX_IOPRIO)
-         LinuxProcess_updateIOPriority(lp);
-      float percent_cpu = (lp->utime + lp->stime - lasttimes) / period * 100.0;
-      proc->percent_cpu = CLAMP(percent_cpu, 0.0, cpus * 100.0);
-      if (isnan(proc->percent_cpu)) proc->percent_cpu = 0.0;
-      proc->percent_mem = (proc->m_resident * CRT_page_size_kib) / (double)(pl->totalMem) * 100.0;
-
-      if(!preExisting) {
-
-         if (! LinuxProcessList_getOwner(proc, pid))
-            goto errorReadingProcess;
-
-         proc->real_user = UsersTable_getRef(pl->usersTable, proc->ruid);
-         proc->effective_user = UsersTable_getRef(pl->usersTable, proc->euid);
-
-         #ifdef HAVE_OPENVZ
-         if (settings->flags & PROCESS_FLAG_LINUX_OPENVZ) {
-            LinuxProcessList_readOpenVZData(lp, dirname, name);
-         }
-         #endif
-         #ifdef HAVE_VSERVER
-         if (settings->flags & PROCESS_FLAG_LINUX_VSERVER) {
-            LinuxProcessList_readVServerData(lp, dirname, name);
-         }
-         #endif
+      #endif
 
+      if (! LinuxProcessList_readCmdlineFile(proc, dirname, name)) {
+         return false;
+      }
+   } else {
+      bool update_name = ProcessList_shouldUpdateProcessNames(pl);
+      #ifdef HAVE_LINUX_CN_PROC_H
+      if (lp->proc_events & LINUX_PROC_EVENT_UID) {
+         if (! LinuxProcessList_getOwner(proc, proc->pid))
+            return false;
+      }
+      if (lp->proc_events & LINUX_PROC_EVENT_EXEC) update_name = true;
+      #endif
+      if (update_name && proc->state != 'Z') {
          if (! LinuxProcessList_readCmdlineFile(proc, dirname, name)) {
-            goto errorReadingProcess;
-         }
-
-         ProcessList_add(pl, proc);
-      } else {
-         if (ProcessList_shouldUpdateProcessNames(pl) && proc->state != 'Z') {
-            if (! LinuxProcessList_readCmdlineFile(proc, dirname, name)) {
-               goto errorReadingProcess;
-            }
+            return false;
          }
       }
+   }
 
-      #ifdef HAVE_DELAYACCT
-      LinuxProcessList_readDelayAcctData(this, lp);
-      #endif
-
+   if (!lp->details_stale) {
       #ifdef HAVE_CGROUP
       if (settings->flags & PROCESS_FLAG_LINUX_CGROUP)
          LinuxProcessList_readCGroupFile(lp, dirname, name);
       #endif
       if (settings->flags & PROCESS_FLAG_LINUX_OOM)
          LinuxProcessList_readOomData(lp, dirname, name);
+   }
 
-      if (!proc->comm || (proc->state == 'Z' && proc->argv0_length == 0)) {
+   if (!proc->comm || (proc->state == 'Z' && proc->argv0_length == 0)) {
+      proc->argv0_length = -1;
+      setCommand(proc, command, commLen);
+   } else if (Process_isExtraThreadProcess(proc)) {
+      if (settings->showThreadNames || (proc->state == 'Z' && proc->argv0_length == 0)) {
          proc->argv0_length = -1;
          setCommand(proc, command, commLen);
-      } else if (Process_isExtraThreadProcess(proc)) {
-         if (settings->showThreadNames || (proc->state == 'Z' && proc->argv0_length == 0)) {
-            proc->argv0_length = -1;
-            setCommand(proc, command, commLen);
-         } else if (settings->showThreadNames && !LinuxProcessList_readCmdlineFile(proc, dirname, name)) {
-            goto errorReadingProcess;
-         }
+      } else if (settings->showThreadNames && !LinuxProcessList_readCmdlineFile(proc, dirname, name)) {
+         return false;
+      }
+   }
+   return true;
+}
+
+typedef struct LinuxProcessScanJob_ {
+   LinuxProcessList* this;
+   int count;
+   int first_chunk;
+   int chunk_step;
+   double period;
+   unsigned long long now;
+} LinuxProcessScanJob;
+
+static void* LinuxProcessList_runScanJob(void* arg) {
+   LinuxProcessScanJob* job = arg;
+   ProcessList* pl = (ProcessList*) job->this;
+   LinuxProcessScanEntry* entries = job->this->scan_entries;
+   ProcessList_enterScan(pl);
+   for (int chunk = job->first_chunk * SCAN_CHUNK_SIZE; chunk < job->count; chunk += job->chunk_step * SCAN_CHUNK_SIZE) {
+      int end = MIN(chunk + SCAN_CHUNK_SIZE, job->count);
+      for (int i = chunk; i < end; i++) {
+         entries[i].ok = entries[i].kept || LinuxProcessList_readProcess(job->this, entries + i, job->period, job->now);
+      }
+      ProcessList_yieldScan(pl);
+   }
+   ProcessList_leaveScan(pl);
+   return NULL;
+}
+
+static void LinuxProcessList_readScanEntries(LinuxProcessList* this, int count, double period, unsigned long long now) {
+   // Fills in the scan entries collected by LinuxProcessList_joinProcesses, using
+   // up to Settings.scan_threads threads. Chunks of entries are interleaved
+   // between threads, so threads of a large process are spread across them as
+   // well. In a background scan, each job gives way to the UI between its chunks.
+   int thread_count = CLAMP(this->super.settings->scan_threads, 1, MAX_SCAN_THREADS);
+   int chunk_count = (count + SCAN_CHUNK_SIZE - 1) / SCAN_CHUNK_SIZE;
+   if (thread_count > chunk_count) thread_count = MAX(chunk_count, 1);
+   LinuxProcessScanJob jobs[thread_count];
+   for (int i = 0; i < thread_count; i++) {
+      jobs[i].this = this;
+      jobs[i].count = count;
+      jobs[i].first_chunk = i;
+      jobs[i].chunk_step = thread_count;
+      jobs[i].period = period;
+      jobs[i].now = now;
+   }
+   // The jobs take their own turns
+   ProcessList_leaveScan(&this->super);
+#ifdef HAVE_PTHREAD
+   if (thread_count > 1) {
+      pthread_t threads[thread_count];
+      bool started[thread_count];
+      for (int i = 1; i < thread_count; i++) {
+         started[i] = pthread_create(threads + i, NULL, LinuxProcessList_runScanJob, jobs + i) == 0;
+      }
+      LinuxProcessList_runScanJob(jobs);
+      for (int i = 1; i < thread_count; i++) {
+         if (started[i]) pthread_join(threads[i], NULL);
+         else LinuxProcessList_runScanJob(jobs + i);
+      }
+      ProcessList_enterScan(&this->super);
+      return;
+   }
+#endif
+   LinuxProcessList_runScanJob(jobs);
+   ProcessList_enterScan(&this->super);
+}
+
+static void LinuxProcessList_mergeScanEntries(LinuxProcessList* this, int count, bool sorted) {
+   // Serialized part of the scan; everything that modifies the ProcessList, the
+   // UsersTable or uses the netlink socket is done here. If the entries are
+   // sorted by PID, the successfully read processes become the new PID index.
+   ProcessList* pl = (ProcessList*) this;
+   if (sorted && count > this->pid_index_size) {
+      this->pid_index_size = count;
+      this->pid_index = xRealloc(this->pid_index, count * sizeof(Process*));
+   }
+   this->pid_index_count = 0;
+   this->pid_index_valid = sorted;
+   Settings* settings = pl->settings;
+   bool hide_kernel_processes = settings->hide_kernel_processes;
+   bool hide_thread_processes = settings->hide_thread_processes;
+   for (int i = 0; i < count; i++) {
+      if (i % SCAN_CHUNK_SIZE == 0) ProcessList_yieldScan(pl);
+      LinuxProcessScanEntry* entry = this->scan_entries + i;
+      Process* proc = entry->process;
+
+      if (!entry->ok) {
+         // Processes that were listed already are left not updated, to be
+         // removed along with the others by ProcessList_scan
+         if (!entry->preExisting) Process_delete((Object*)proc);
+         continue;
       }
+
+      if (!entry->preExisting) {
+         proc->real_user = UsersTable_getRef(pl->usersTable, proc->ruid);
+         proc->effective_user = UsersTable_getRef(pl->usersTable, proc->euid);
+         ProcessList_add(pl, proc);
+      }
+      #ifdef HAVE_LINUX_CN_PROC_H
+      else if (((LinuxProcess*)proc)->proc_events & LINUX_PROC_EVENT_UID) {
+         proc->real_user = UsersTable_getRef(pl->usersTable, proc->ruid);
+         proc->effective_user = UsersTable_getRef(pl->usersTable, proc->euid);
+      }
+      ((LinuxProcess*)proc)->proc_events = 0;
+      #endif
+
+      #ifdef HAVE_DELAYACCT
+      if (!entry->kept) LinuxProcessList_readDelayAcctData(this, (LinuxProcess*)proc);
+      #endif
+
       pl->totalTasks++;
       pl->thread_count++;
       if (Process_isKernelProcess(proc)) {
@@ -969,21 +1470,337 @@ static bool LinuxProcessList_recurseProcTree(LinuxProcessList* this, const char*
       proc->show = !((hide_kernel_processes && Process_isKernelProcess(proc)) || (hide_thread_processes && Process_isExtraThreadProcess(proc)));
 
       proc->updated = true;
-      continue;
+      if (sorted) this->pid_index[this->pid_index_count++] = proc;
+   }
+}
+
+#ifdef HAVE_LINUX_CN_PROC_H
+
+static bool LinuxProcessList_sendProcEventControl(int fd, enum proc_cn_mcast_op op) {
+   union {
+      struct nlmsghdr header;
+      char buffer[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op))];
+   } request;
+   memset(&request, 0, sizeof request);
+   request.header.nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op));
+   request.header.nlmsg_type = NLMSG_DONE;
+   request.header.nlmsg_pid = getpid();
+   struct cn_msg* message = NLMSG_DATA(&request.header);
+   message->id.idx = CN_IDX_PROC;
+   message->id.val = CN_VAL_PROC;
+   message->len = sizeof(enum proc_cn_mcast_op);
+   memcpy(message->data, &op, sizeof op);
+   return send(fd, &request, request.header.nlmsg_len, 0) >= 0;
+}
+
+static void LinuxProcessList_openProcEventSocket(LinuxProcessList* this) {
+   int fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+   if (fd == -1) {
+      this->proc_event_socket_failed = true;
+      return;
+   }
+   struct sockaddr_nl addr;
+   memset(&addr, 0, sizeof addr);
+   addr.nl_family = AF_NETLINK;
+   addr.nl_groups = CN_IDX_PROC;
+   int buffer_size = PROC_EVENT_SOCKET_BUFFER_SIZE;
+   setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof buffer_size);
+   if (bind(fd, (struct sockaddr*)&addr, sizeof addr) < 0 ||
+      !LinuxProcessList_sendProcEventControl(fd, PROC_CN_MCAST_LISTEN)) {
+      close(fd);
+      this->proc_event_socket_failed = true;
+      return;
+   }
+   this->proc_event_socket = fd;
+   this->event_count = 0;
+}
+
+static void LinuxProcessList_closeProcEventSocket(LinuxProcessList* this) {
+   LinuxProcessList_sendProcEventControl(this->proc_event_socket, PROC_CN_MCAST_IGNORE);
+   close(this->proc_event_socket);
+   this->proc_event_socket = -1;
+   this->event_count = 0;
+}
+
+static LinuxProcessEvent* LinuxProcessList_addEvent(LinuxProcessList* this, unsigned int what, pid_t pid, pid_t tgid) {
+   if (this->event_count >= this->events_size) {
+      this->events_size = this->events_size ? this->events_size * 2 : 64;
+      this->events = xRealloc(this->events, this->events_size * sizeof(LinuxProcessEvent));
+   }
+   LinuxProcessEvent* event = this->events + this->event_count;
+   event->what = what;
+   event->order = this->event_count++;
+   event->pid = pid;
+   event->tgid = tgid;
+   event->ppid = 0;
+   event->comm[0] = '\0';
+   return event;
+}
+
+static void LinuxProcessList_setProcEventFlag(LinuxProcessList* this, pid_t pid, unsigned int flag) {
+   LinuxProcess* lp = Hashtable_get(this->super.processTable, pid);
+   if (lp) lp->proc_events |= flag;
+}
 
-      // Exception handler.
-      errorReadingProcess: {
-         if (preExisting) {
-            ProcessList_remove(pl, proc);
+static void LinuxProcessList_handleProcEvent(LinuxProcessList* this, const struct proc_event* event) {
+   // Events about listed processes are flagged on them, the others are kept
+   // for LinuxProcessList_addTrackedProcesses to pair forks with exits.
+   Hashtable* processTable = this->super.processTable;
+   switch (event->what) {
+      case PROC_EVENT_FORK: {
+         LinuxProcessEvent* fork = LinuxProcessList_addEvent(this, PROC_EVENT_FORK, event->event_data.fork.child_pid, event->event_data.fork.child_tgid);
+         fork->ppid = event->event_data.fork.parent_tgid;
+         // The child starts with the parent's command
+         const Process* parent = Hashtable_get(processTable, fork->ppid);
+         if (parent && parent->name) snprintf(fork->comm, sizeof(fork->comm), "%s", parent->name);
+         break;
+      }
+      case PROC_EVENT_EXEC: {
+         pid_t pid = event->event_data.exec.process_pid;
+         if (Hashtable_get(processTable, pid)) LinuxProcessList_setProcEventFlag(this, pid, LINUX_PROC_EVENT_EXEC);
+         else LinuxProcessList_addEvent(this, PROC_EVENT_EXEC, pid, event->event_data.exec.process_tgid);
+         break;
+      }
+      case PROC_EVENT_UID:
+         LinuxProcessList_setProcEventFlag(this, event->event_data.id.process_pid, LINUX_PROC_EVENT_UID);
+         break;
+      case PROC_EVENT_EXIT: {
+         pid_t pid = event->event_data.exit.process_pid;
+         LinuxProcess* lp = Hashtable_get(processTable, pid);
+         // An exited process whose PID was taken again may exit a second time
+         if (lp && !(lp->proc_events & LINUX_PROC_EVENT_EXIT)) lp->proc_events |= LINUX_PROC_EVENT_EXIT;
+         else LinuxProcessList_addEvent(this, PROC_EVENT_EXIT, pid, event->event_data.exit.process_tgid);
+         break;
+      }
+      case PROC_EVENT_COMM: {
+         pid_t pid = event->event_data.comm.process_pid;
+         if (Hashtable_get(processTable, pid)) {
+            LinuxProcessList_setProcEventFlag(this, pid, LINUX_PROC_EVENT_COMM);
          } else {
-            Process_delete((Object*)proc);
+            LinuxProcessEvent* comm = LinuxProcessList_addEvent(this, PROC_EVENT_COMM, pid, event->event_data.comm.process_tgid);
+            snprintf(comm->comm, sizeof(comm->comm), "%s", event->event_data.comm.comm);
          }
+         break;
       }
    }
-   closedir(dir);
+}
+
+static void LinuxProcessList_readProcEvents(LinuxProcessList* this) {
+   union {
+      struct nlmsghdr header;
+      char buffer[8192];
+   } reply;
+   while (true) {
+      struct sockaddr_nl addr;
+      socklen_t addr_len = sizeof addr;
+      ssize_t len = recvfrom(this->proc_event_socket, &reply, sizeof reply, 0, (struct sockaddr*)&addr, &addr_len);
+      if (len < 0) {
+         if (errno == EINTR) continue;
+         // Some events were dropped by the kernel
+         if (errno == ENOBUFS) {
+            this->need_full_scan = true;
+            continue;
+         }
+         break;
+      }
+      if (addr.nl_pid != 0) continue;
+      int remaining = len;
+      for (struct nlmsghdr* header = &reply.header; NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining)) {
+         if (header->nlmsg_type != NLMSG_DONE) continue;
+         const struct cn_msg* message = NLMSG_DATA(header);
+         if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC) continue;
+         LinuxProcessList_handleProcEvent(this, (const struct proc_event*)message->data);
+      }
+      ProcessList_yieldScan((ProcessList*) this);
+   }
+}
+
+static bool LinuxProcessList_updateProcEvents(LinuxProcessList* this) {
+   // Opens, closes or drains the proc connector socket according to the
+   // settings. Returns true if the processes could be updated from the
+   // tracked events, false if the whole /proc should be walked instead.
+   if (!this->super.settings->use_proc_events) {
+      if (this->proc_event_socket != -1) LinuxProcessList_closeProcEventSocket(this);
+      this->proc_event_socket_failed = false;
+      return false;
+   }
+   if (this->proc_event_socket == -1) {
+      // Processes created before the socket was opened are found by a full
+      // scan
+      if (!this->proc_event_socket_failed) LinuxProcessList_openProcEventSocket(this);
+      return false;
+   }
+   LinuxProcessList_readProcEvents(this);
+   if (this->need_full_scan || ++this->scans_since_full_scan >= PROC_EVENTS_FULL_SCAN_INTERVAL) {
+      this->need_full_scan = false;
+      this->scans_since_full_scan = 0;
+      return false;
+   }
    return true;
 }
 
+static int compareEvents(const void* va, const void* vb) {
+   const LinuxProcessEvent* a = va;
+   const LinuxProcessEvent* b = vb;
+   if (a->pid != b->pid) return a->pid < b->pid ? -1 : 1;
+   return a->order == b->order ? 0 : (a->order < b->order ? -1 : 1);
+}
+
+static void LinuxProcessList_keepEvent(LinuxProcessList* this, const LinuxProcessEvent* event, unsigned int what, int* queued) {
+   LinuxProcessEvent* kept = this->events + *queued;
+   *kept = *event;
+   kept->what = what;
+   kept->order = (*queued)++;
+}
+
+static void LinuxProcessList_keepExited(LinuxProcessList* this, const LinuxProcessEvent* fork, unsigned int what) {
+   if (this->exited_count >= this->exited_size) {
+      this->exited_size = this->exited_size ? this->exited_size * 2 : 64;
+      this->exited = xRealloc(this->exited, this->exited_size * sizeof(LinuxProcessEvent));
+   }
+   this->exited[this->exited_count] = *fork;
+   this->exited[this->exited_count++].what = what;
+}
+
+static void LinuxProcessList_takeFork(LinuxProcessList* this, int* count, const LinuxProcessEvent* fork, bool execed, bool exited, bool tracked, int* queued) {
+   ProcessList* pl = (ProcessList*) this;
+   LinuxProcess* old = Hashtable_get(pl->processTable, fork->pid);
+   if (old) {
+      // Unless the old process has exited, this one was already found
+      // by the last full scan
+      if (!tracked || !(old->proc_events & LINUX_PROC_EVENT_EXIT)) return;
+      // The panel may still show the old process, so it is left not
+      // updated for ProcessList_complete to drop, and the new one is
+      // added by the next scan
+      old->proc_events |= LINUX_PROC_EVENT_REUSED;
+      LinuxProcessList_keepEvent(this, fork, PROC_EVENT_FORK, queued);
+      if (execed) LinuxProcessList_keepEvent(this, fork, PROC_EVENT_EXEC, queued);
+      if (exited) LinuxProcessList_keepEvent(this, fork, PROC_EVENT_EXIT, queued);
+      return;
+   }
+   if (exited) {
+      // Threads are left out once they exited, as they are on full scans
+      if (fork->pid != fork->tgid) return;
+      // Kept as an exec when the command it ran isn't known
+      LinuxProcessList_keepExited(this, fork, execed ? PROC_EVENT_EXEC : PROC_EVENT_FORK);
+      return;
+   }
+   // A full scan finds it in /proc
+   if (!tracked) return;
+   Process* proc = (Process*) LinuxProcess_new(pl->settings);
+   proc->pid = fork->pid;
+   proc->tgid = fork->tgid;
+   LinuxProcessList_addScanEntry(this, count, proc, false);
+}
+
+static void LinuxProcessList_takeForks(LinuxProcessList* this, int* count, bool tracked) {
+   // Pairs each fork since last scan with the command changes and the exit
+   // that followed it. Processes that exited already are kept in
+   // this->exited, for LinuxProcessList_addExitedProcesses. When tracking,
+   // the new processes are queued to be read, and forks onto the PIDs of
+   // exited processes still listed are kept for the next scan.
+   qsort(this->events, this->event_count, sizeof(LinuxProcessEvent), compareEvents);
+   int event_count = this->event_count;
+   int queued = 0;
+   this->exited_count = 0;
+   for (int i = 0; i < event_count;) {
+      LinuxProcessEvent fork = this->events[i++];
+      // Exits and command changes of processes forked before the last scan
+      // and not listed are of no use
+      if (fork.what != PROC_EVENT_FORK) continue;
+      bool execed = false;
+      bool exited = false;
+      for (; i < event_count && this->events[i].pid == fork.pid && this->events[i].what != PROC_EVENT_FORK; i++) {
+         const LinuxProcessEvent* event = this->events + i;
+         if (event->what == PROC_EVENT_EXIT) {
+            exited = true;
+         } else if (event->what == PROC_EVENT_COMM) {
+            memcpy(fork.comm, event->comm, sizeof(fork.comm));
+            execed = false;
+         } else {
+            execed = true;
+         }
+      }
+      LinuxProcessList_takeFork(this, count, &fork, execed, exited, tracked, &queued);
+   }
+   this->event_count = queued;
+}
+
+static void LinuxProcessList_addTrackedProcesses(LinuxProcessList* this, int* count) {
+   // Alternative to LinuxProcessList_joinProcesses, collecting the already
+   // known processes and the ones created since last scan, without reading
+   // the /proc directory.
+   // Only the processes with events, the ones on screen and zombies are
+   // read again, the others keep their values until the next full scan.
+   ProcessList* pl = (ProcessList*) this;
+   int size = Vector_size(pl->processes);
+   LinuxProcessList_takeForks(this, count, true);
+
+   for (int i = 0; i < size; i++) {
+      LinuxProcess* lp = (LinuxProcess*) Vector_get(pl->processes, i);
+      lp->super.created = false;
+      lp->super.updated = false;
+      lp->super.show = true;
+      // Threads other than the main thread are released as soon as they
+      // exit, while processes stay as zombies until being reaped
+      if ((lp->proc_events & LINUX_PROC_EVENT_EXIT) && lp->super.pid != lp->super.tgid) continue;
+      if (lp->proc_events & (LINUX_PROC_EVENT_REUSED | LINUX_PROC_EVENT_GONE)) continue;
+      LinuxProcessScanEntry* entry = LinuxProcessList_addScanEntry(this, count, (Process*)lp, true);
+      entry->kept = !lp->proc_events && !entry->pinned && lp->super.state != 'Z';
+   }
+}
+
+static void LinuxProcessList_addExitedProcesses(LinuxProcessList* this) {
+   // Lists the processes that forked and exited since last scan as dead
+   // processes, with what the events and their parent tell about them, so
+   // short-lived processes are seen for a scan. The next scan drops them.
+   ProcessList* pl = (ProcessList*) this;
+   for (int i = 0; i < this->exited_count; i++) {
+      const LinuxProcessEvent* fork = this->exited + i;
+      // The PID may have been taken again already
+      if (Hashtable_get(pl->processTable, fork->pid)) continue;
+      LinuxProcess* lp = LinuxProcess_new(pl->settings);
+      Process* proc = (Process*) lp;
+      proc->pid = fork->pid;
+      proc->tgid = fork->tgid;
+      proc->ppid = fork->ppid;
+      proc->state = 'X';
+      const char* comm = fork->comm;
+      const LinuxProcess* parent = Hashtable_get(pl->processTable, fork->ppid);
+      if (parent) {
+         // Owner, terminal and priority are inherited on fork
+         proc->ruid = parent->super.ruid;
+         proc->euid = parent->super.euid;
+         proc->real_user = parent->super.real_user;
+         proc->effective_user = parent->super.effective_user;
+         proc->pgrp = parent->super.pgrp;
+         proc->session = parent->super.session;
+         proc->tty_nr = parent->super.tty_nr;
+         proc->tpgid = parent->super.tpgid;
+         proc->priority = parent->super.priority;
+         proc->nice = parent->super.nice;
+         if (parent->ttyDevice) lp->ttyDevice = xStrdup(parent->ttyDevice);
+         if (!comm[0] && parent->super.name) comm = parent->super.name;
+      } else {
+         proc->ruid = proc->euid = (uid_t)-1;
+      }
+      if (!comm[0]) comm = "?";
+      String_update(&proc->name, comm);
+      // After an exec, the process ran something else than its parent
+      char command[sizeof(fork->comm) + 8];
+      snprintf(command, sizeof(command), fork->what == PROC_EVENT_EXEC ? "%s (exec)" : "%s", comm);
+      setCommand(proc, command, strlen(command));
+      lp->proc_events = LINUX_PROC_EVENT_EXIT | LINUX_PROC_EVENT_GONE;
+      proc->updated = true;
+      ProcessList_add(pl, proc);
+      // The PID index is made again, so the next full scan finds it
+      this->pid_index_valid = false;
+   }
+   this->exited_count = 0;
+}
+
+#endif
+
 static inline void LinuxProcessList_scanMemoryInfo(ProcessList* this) {
    unsigned long long int swapFree = 0;
    unsigned long long int shmem = 0;
@@ -1121,10 +1938,38 @@ void ProcessList_goThroughEntries(ProcessList* super, bool skip_processes) {
 
    LinuxProcessList_scanMemoryInfo(super);
    double period = LinuxProcessList_scanCPUTime(this);
+   this->cpu_period_sum += period;
+   ProcessList_yieldScan(super);
 
-   if(skip_processes) return;
+   if(skip_processes) {
+      // ProcessList_scan drops every process
+      this->pid_index_valid = false;
+      return;
+   }
 
    struct timeval tv;
    gettimeofday(&tv, NULL);
-   LinuxProcessList_recurseProcTree(this, PROCDIR, NULL, period, tv);
+   unsigned long long now = tv.tv_sec*1000LL+tv.tv_usec/1000LL;
+   int count = 0;
+   bool sorted = true;
+   this->scan_generation++;
+   #ifdef HAVE_LINUX_CN_PROC_H
+   bool tracked = LinuxProcessList_updateProcEvents(this);
+   if (tracked) {
+      LinuxProcessList_addTrackedProcesses(this, &count);
+      sorted = false;
+   } else
+   #endif
+   {
+      LinuxProcessList_enumeratePids(this);
+      LinuxProcessList_joinProcesses(this, &count);
+   }
+   LinuxProcessList_readScanEntries(this, count, period, now);
+   LinuxProcessList_mergeScanEntries(this, count, sorted);
+   #ifdef HAVE_LINUX_CN_PROC_H
+   // Full scans still list the processes that were too short-lived to be
+   // found in /proc
+   if (!tracked && this->proc_event_socket != -1) LinuxProcessList_takeForks(this, &count, false);
+   LinuxProcessList_addExitedProcesses(this);
+   #endif
 }
@@ -10,6 +10,8 @@ Released under the GNU GPL, see the COPYING file
 in the source distribution for its full text.
 */
 
+#ifdef HAVE_PTHREAD
+#endif
 #ifdef MAJOR_IN_MKDEV
 #elif defined MAJOR_IN_SYSMACROS
 #endif
@@ -17,8 +19,12 @@ in the source distribution for its full text.
 #ifdef HAVE_DELAYACCT
 #endif
 
+#ifdef HAVE_LINUX_CN_PROC_H
+#endif
+
 
 #include "ProcessList.h"
+#include "LinuxProcess.h"
 
 extern long long btime;
 
@@ -56,6 +62,32 @@ typedef struct TtyDriver_ {
    unsigned int minorTo;
 } TtyDriver;
 
+typedef struct LinuxProcessScanEntry_ {
+   Process* process;
+   bool preExisting;
+   bool pinned;
+   // Left as it was, as nothing was reported about it since last scan
+   bool kept;
+   bool ok;
+} LinuxProcessScanEntry;
+
+typedef struct LinuxProcessPid_ {
+   pid_t pid;
+   pid_t tgid;
+} LinuxProcessPid;
+
+typedef struct LinuxProcessEvent_ {
+   // PROC_EVENT_FORK, PROC_EVENT_EXEC, PROC_EVENT_EXIT or PROC_EVENT_COMM
+   unsigned int what;
+   // Position in the order the events came in
+   int order;
+   pid_t pid;
+   pid_t tgid;
+   pid_t ppid;
+   // The command of the process, the parent's one for a fork, when known
+   char comm[16];
+} LinuxProcessEvent;
+
 typedef struct LinuxProcessList_ {
    ProcessList super;
    CPUData* cpus;
@@ -65,6 +97,35 @@ typedef struct LinuxProcessList_ {
    int netlink_family;
    #endif
    bool support_kthread_flag;
+   LinuxProcessScanEntry *scan_entries;
+   int scan_entries_size;
+   LinuxProcessFdCache fd_cache;
+   unsigned int scan_generation;
+   // Sum of the CPU periods of all scans, as processes may not be read on
+   // every scan
+   double cpu_period_sum;
+   char* dirent_buffer;
+   LinuxProcessPid* pids;
+   int pid_count;
+   int pids_size;
+   Process** pid_index;
+   int pid_index_count;
+   int pid_index_size;
+   bool pid_index_valid;
+   #ifdef HAVE_LINUX_CN_PROC_H
+   int proc_event_socket;
+   bool proc_event_socket_failed;
+   bool need_full_scan;
+   unsigned int scans_since_full_scan;
+   // Forks, and exits and command changes of processes not listed yet
+   LinuxProcessEvent* events;
+   int event_count;
+   int events_size;
+   // Processes that forked and exited since last scan, listed after it
+   LinuxProcessEvent* exited;
+   int exited_count;
+   int exited_size;
+   #endif
 } LinuxProcessList;
 
 #ifndef PROCDIR
@@ -100,6 +161,34 @@ typedef struct LinuxProcessList_ {
 #define CLAMP(x,low,high) (((x)>(high))?(high):(((x)<(low))?(low):(x)))
 #endif
 
+// Number of consecutive scan entries handed to a worker thread at once
+#define SCAN_CHUNK_SIZE 32
+
+// Upper limit for Settings.scan_threads
+#define MAX_SCAN_THREADS 256
+
+#define DIRENT_BUFFER_SIZE (256 * 1024)
+
+// File descriptors kept open by a process in the fd cache: the /proc/<pid>
+// directory, 'stat' and 'statm'
+#define CACHED_FDS_PER_PROCESS 3
+
+#ifndef O_PATH
+#define O_PATH O_RDONLY
+#endif
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+#ifdef HAVE_LINUX_CN_PROC_H
+// When tracking processes with the proc connector, still walk the whole
+// /proc on every this many scans, in case of missed events
+#define PROC_EVENTS_FULL_SCAN_INTERVAL 10
+
+#define PROC_EVENT_SOCKET_BUFFER_SIZE (1 << 20)
+#endif
+
 #ifdef HAVE_DELAYACCT
 
 #endif
@@ -108,6 +197,30 @@ ProcessList* ProcessList_new(UsersTable* usersTable, const Hashtable *pidWhiteLi
 
 void ProcessList_delete(ProcessList* pl);
 
+// Field numbers of /proc/<pid>/stat, as listed in proc(5)
+#define STAT_FIELD_STATE 3
+#define STAT_FIELD_PPID 4
+#define STAT_FIELD_PGRP 5
+#define STAT_FIELD_SESSION 6
+#define STAT_FIELD_TTY_NR 7
+#define STAT_FIELD_TPGID 8
+#define STAT_FIELD_FLAGS 9
+#define STAT_FIELD_MINFLT 10
+#define STAT_FIELD_CMINFLT 11
+#define STAT_FIELD_MAJFLT 12
+#define STAT_FIELD_CMAJFLT 13
+#define STAT_FIELD_UTIME 14
+#define STAT_FIELD_STIME 15
+#define STAT_FIELD_CUTIME 16
+#define STAT_FIELD_CSTIME 17
+#define STAT_FIELD_PRIORITY 18
+#define STAT_FIELD_NICE 19
+#define STAT_FIELD_NUM_THREADS 20
+#define STAT_FIELD_STARTTIME 22
+#define STAT_FIELD_EXIT_SIGNAL 38
+#define STAT_FIELD_PROCESSOR 39
+
+
 // Only used for Linux without PF_KTHREAD flag support (version < 2.6.27).
 #ifdef HAVE_TASKSTATS
 
@@ -129,6 +242,14 @@ void ProcessList_delete(ProcessList* pl);
 
 #endif
 
+#ifdef SYS_getdents64
+#endif
+
+
+#ifdef HAVE_LINUX_CN_PROC_H
+
+#endif
+
 void ProcessList_goThroughEntries(ProcessList* super, bool skip_processes);
 
 #endif
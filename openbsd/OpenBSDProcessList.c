@@ -249,6 +249,7 @@ static inline void OpenBSDProcessList_scanProcs(ProcessList *this) {
 #endif
 
    for (i = 0; i < count; i++) {
+      ProcessList_yieldScan(this);
       struct kinfo_proc *kproc = kprocs + i;
 #ifdef HAVE_STRUCT_KINFO_PROC_P_TID
       if((hide_high_level_processes || kproc->p_pid == 0) && kproc->p_tid == -1) continue;
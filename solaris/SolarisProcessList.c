@@ -325,6 +325,7 @@ static int SolarisProcessList_walkproc(psinfo_t *_psinfo, lwpsinfo_t *_lwpsinfo,
    // Setup process list
    ProcessList *pl = (ProcessList*) listptr;
    SolarisProcessList *spl = (SolarisProcessList*) listptr;
+   ProcessList_yieldScan(pl);
 
    id_t lwpid_real = _lwpsinfo->pr_lwpid;
    if (lwpid_real > 1023) return 0;
@@ -459,6 +460,7 @@ void ProcessList_goThroughEntries(ProcessList *super, bool skip_processes) {
 
 	struct dirent *e;
 	while((e = readdir(this->proc_dir))) {
+		ProcessList_yieldScan(super);
 		bool is_existing;
 		char *end_p;
 		long int pid = strtol(e->d_name, &end_p, 10);